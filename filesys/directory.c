@@ -2,9 +2,11 @@
 #include <stdio.h>
 #include <string.h>
 #include <list.h>
+#include <round.h>
 #include "filesys/filesys.h"
 #include "filesys/inode.h"
 #include "threads/malloc.h"
+#include "threads/slab.h"
 
 /* A directory. */
 struct dir 
@@ -21,6 +23,16 @@ struct dir_entry
     bool in_use;                        /* In use or free? */
   };
 
+/* Cache of struct dir. */
+static struct kmem_cache *dir_cache;
+
+/* Initializes the directory module. */
+void
+dir_init (void) 
+{
+  dir_cache = kmem_cache_create ("dir", sizeof (struct dir), NULL);
+}
+
 /* Creates a directory with space for ENTRY_CNT entries in the
    given SECTOR.  Returns true if successful, false on failure. */
 bool
@@ -34,7 +46,7 @@ dir_create (block_sector_t sector, size_t entry_cnt)
 struct dir *
 dir_open (struct inode *inode) 
 {
-  struct dir *dir = calloc (1, sizeof *dir);
+  struct dir *dir = kmem_cache_alloc (dir_cache);
   if (inode != NULL && dir != NULL)
     {
       dir->inode = inode;
@@ -44,7 +56,7 @@ dir_open (struct inode *inode)
   else
     {
       inode_close (inode);
-      free (dir);
+      kmem_cache_free (dir_cache, dir);
       return NULL; 
     }
 }
@@ -65,6 +77,17 @@ dir_reopen (struct dir *dir)
   return dir_open (inode_reopen (dir->inode));
 }
 
+/* Opens and returns a new directory for the same inode as DIR,
+   positioned where DIR is.  Returns a null pointer on failure. */
+struct dir *
+dir_dup (struct dir *dir) 
+{
+  struct dir *copy = dir_reopen (dir);
+  if (copy != NULL)
+    copy->pos = dir->pos;
+  return copy;
+}
+
 /* Destroys DIR and frees associated resources. */
 void
 dir_close (struct dir *dir) 
@@ -72,7 +95,7 @@ dir_close (struct dir *dir)
   if (dir != NULL)
     {
       inode_close (dir->inode);
-      free (dir);
+      kmem_cache_free (dir_cache, dir);
     }
 }
 
@@ -251,6 +274,65 @@ dir_readdir (struct dir *dir, char name[NAME_MAX + 1])
   return false;
 }
 
+/* Reads up to CNT of the next entries in DIR into RECORDS, along
+   with each entry's inode number and whether it is a directory.
+   Reads the directory up to the end of a sector at a time,
+   rather than one entry at a time as dir_readdir() does, so that
+   each read covers a single sector except for reads of an entry
+   that straddles two.  Returns the number of entries read, which
+   is 0 if the directory contains no more entries. */
+size_t
+dir_readdir_many (struct dir *dir, struct dir_record *records, size_t cnt)
+{
+  enum { BATCH = BLOCK_SECTOR_SIZE / sizeof (struct dir_entry) };
+  struct dir_entry *batch;
+  size_t record_cnt = 0;
+
+  batch = malloc (BATCH * sizeof *batch);
+  if (batch == NULL)
+    return 0;
+
+  lock_inode (dir->inode);
+  while (record_cnt < cnt) 
+    {
+      off_t sector_end = ROUND_UP (dir->pos + 1, BLOCK_SECTOR_SIZE);
+      size_t want = (sector_end - dir->pos) / sizeof *batch;
+      off_t size;
+      size_t entry_cnt;
+      size_t i;
+
+      if (want == 0)
+        want = 1;
+      size = inode_read_at (dir->inode, batch, want * sizeof *batch,
+                            dir->pos);
+      entry_cnt = size / sizeof *batch;
+
+      if (entry_cnt == 0)
+        break;
+      for (i = 0; i < entry_cnt && record_cnt < cnt; i++) 
+        {
+          struct dir_entry *e = &batch[i];
+          struct dir_record *r;
+          struct inode *inode;
+
+          dir->pos += sizeof *e;
+          if (!e->in_use)
+            continue;
+
+          r = &records[record_cnt++];
+          r->inumber = e->inode_sector;
+          strlcpy (r->name, e->name, sizeof r->name);
+          inode = inode_open (e->inode_sector);
+          r->is_dir = inode != NULL && is_inode_directory (inode);
+          inode_close (inode);
+        }
+    }
+  unlock_inode (dir->inode);
+
+  free (batch);
+  return record_cnt;
+}
+
 bool get_previous(struct dir* dir, struct inode **inode){
 	block_sector_t sector = get_previous_inode(dir_get_inode(dir));
 	*inode = inode_open(sector);
@@ -13,11 +13,23 @@
 
 struct inode;
 
+/* A directory entry as returned by dir_readdir_many().  Matches
+   struct dirent in lib/user/syscall.h. */
+struct dir_record 
+  {
+    block_sector_t inumber;             /* Inode sector. */
+    bool is_dir;                        /* Is it a directory? */
+    char name[NAME_MAX + 1];            /* Null terminated file name. */
+  };
+
+void dir_init (void);
+
 /* Opening and closing directories. */
 bool dir_create (block_sector_t sector, size_t entry_cnt);
 struct dir *dir_open (struct inode *);
 struct dir *dir_open_root (void);
 struct dir *dir_reopen (struct dir *);
+struct dir *dir_dup (struct dir *);
 void dir_close (struct dir *);
 struct inode *dir_get_inode (struct dir *);
 
@@ -26,6 +38,7 @@ bool dir_lookup (const struct dir *, const char *name, struct inode **);
 bool dir_add (struct dir *, const char *name, block_sector_t);
 bool dir_remove (struct dir *, const char *name);
 bool dir_readdir (struct dir *, char name[NAME_MAX + 1]);
+size_t dir_readdir_many (struct dir *, struct dir_record *, size_t cnt);
 
 
 bool get_previous(struct dir* dir, struct inode **inode);
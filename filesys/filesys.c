@@ -13,6 +13,7 @@
 struct block *fs_device;
 
 static void do_format (void);
+static block_sector_t inode_goal (struct dir *, bool isDirectory);
 
 /* Initializes the file system module.
    If FORMAT is true, reformats the file system. */
@@ -24,6 +25,8 @@ filesys_init (bool format)
     PANIC ("No file system device found, can't initialize file system.");
 
   inode_init ();
+  file_init ();
+  dir_init ();
   free_map_init ();
 
   if (format) 
@@ -52,7 +55,8 @@ filesys_create (const char *name, off_t initial_size,bool isDirectory)
   bool success = false;
   if(strcmp(filename, ".") != 0 && strcmp(filename, "..") != 0){
   	success = (dir != NULL
-               	  && free_map_allocate (1, &inode_sector)
+               	  && free_map_allocate_goal (inode_goal (dir, isDirectory),
+                                             1, &inode_sector)
                   && inode_create (inode_sector, initial_size,isDirectory)
                   && dir_add (dir, filename, inode_sector));
   }
@@ -72,6 +76,19 @@ filesys_create (const char *name, off_t initial_size,bool isDirectory)
    or if an internal memory allocation fails. */
 struct file *
 filesys_open (const char *name)
+{
+  struct inode *inode = filesys_lookup(name);
+  if(!inode){return NULL;}
+  if(is_inode_directory(inode)){return (struct file *) dir_open(inode);}
+  return file_open (inode);
+}
+
+/* Looks up the file or directory with the given NAME and returns
+   its inode, which the caller must close, or a null pointer if
+   there is none.  Unlike filesys_open(), does not allocate a
+   struct file or struct dir for it. */
+struct inode *
+filesys_lookup (const char *name)
 {
   if(strlen(name) == 0){return NULL;}
   struct dir *dir = get_dir(name);
@@ -80,16 +97,10 @@ filesys_open (const char *name)
 
   if (dir != NULL){
 	if(strcmp(filename, "..") == 0){
-		bool success = get_previous(dir, &inode);
-		if(!success){free(filename); return NULL;}
+		get_previous(dir, &inode);
 	}
-	else if(check_if_root(dir) && strlen(filename) == 0){
-		free(filename);
-		return (struct file*) dir;
-	}
-	else if(strcmp(filename, ".") == 0){
-		free(filename);
-		return (struct file*) dir;
+	else if(strlen(filename) == 0 || strcmp(filename, ".") == 0){
+		inode = inode_reopen(dir_get_inode(dir));
 	}
 	else{
 		dir_lookup (dir, filename, &inode);
@@ -97,9 +108,7 @@ filesys_open (const char *name)
   } 
   dir_close (dir);
   free(filename);
-  if(!inode){return NULL;}
-  if(is_inode_directory(inode)){return (struct file *) dir_open(inode);}
-  return file_open (inode);
+  return inode;
 }
 
 /* Deletes the file named NAME.
@@ -155,6 +164,19 @@ change_directory( const char *name){
   return false;
 }
 
+/* Returns the sector near which to put the inode of a new file
+   or directory in DIR.  A file goes in its directory's group,
+   next to its siblings; a new directory starts off in the
+   emptiest group, so that unrelated subtrees spread out across
+   the disk and each keeps room to grow locally. */
+static block_sector_t
+inode_goal (struct dir *dir, bool isDirectory)
+{
+  if (isDirectory)
+    return free_map_emptiest_group ();
+  return inode_get_inumber (dir_get_inode (dir));
+}
+
 /* Formats the file system. */
 static void
 do_format (void)
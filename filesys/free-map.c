@@ -1,22 +1,78 @@
 #include "filesys/free-map.h"
 #include <bitmap.h>
 #include <debug.h>
+#include <round.h>
 #include "filesys/file.h"
 #include "filesys/filesys.h"
 #include "filesys/inode.h"
 
+/* Free space index.
+
+   The free map proper is a bitmap with one bit per sector, which
+   is also what is stored on disk.  On top of it, the sectors are
+   divided into groups of group_sectors each, and for each group
+   we keep a count of its free sectors plus a summary bitmap with
+   one bit per group that is set if the group has any free
+   sectors at all.  These are rebuilt from the free map when it
+   is read and kept up to date as sectors are allocated and
+   released.
+
+   Allocation starts from a goal sector and goes to the first
+   group at or after the goal's (wrapping around) that has
+   enough free sectors, so it skips full parts of the disk
+   without looking at their bits. */
+
 static struct file *free_map_file;   /* Free map file. */
 static struct bitmap *free_map;      /* Free map, one bit per sector. */
+static size_t next_sector;           /* Default goal for allocation. */
+
+/* Groups. */
+#define MIN_GROUP_SECTORS 128        /* Smallest group. */
+#define MAX_GROUPS 64                /* Most groups, for large disks. */
+static size_t group_sectors;         /* Sectors per group, a power of 2. */
+static size_t group_cnt;             /* Number of groups. */
+static size_t group_free[MAX_GROUPS]; /* Free sectors in each group. */
+static struct bitmap *group_map;     /* Groups with free sectors. */
+
+static void mark_sectors (block_sector_t, size_t cnt, bool used);
+static void count_group_free (void);
+static block_sector_t find_sectors (block_sector_t goal, size_t cnt);
 
 /* Initializes the free map. */
 void
 free_map_init (void) 
 {
-  free_map = bitmap_create (block_size (fs_device));
+  size_t sector_cnt = block_size (fs_device);
+
+  free_map = bitmap_create (sector_cnt);
   if (free_map == NULL)
     PANIC ("bitmap creation failed--file system device is too large");
-  bitmap_mark (free_map, FREE_MAP_SECTOR);
-  bitmap_mark (free_map, ROOT_DIR_SECTOR);
+
+  for (group_sectors = MIN_GROUP_SECTORS;
+       group_sectors * MAX_GROUPS < sector_cnt; group_sectors *= 2)
+    continue;
+  group_cnt = DIV_ROUND_UP (sector_cnt, group_sectors);
+  group_map = bitmap_create (group_cnt);
+  if (group_map == NULL)
+    PANIC ("free map group summary creation failed");
+  count_group_free ();
+
+  mark_sectors (FREE_MAP_SECTOR, 1, true);
+  mark_sectors (ROOT_DIR_SECTOR, 1, true);
+}
+
+/* Returns the first sector of the group with the most free
+   sectors. */
+block_sector_t
+free_map_emptiest_group (void) 
+{
+  size_t best = 0;
+  size_t g;
+
+  for (g = 1; g < group_cnt; g++)
+    if (group_free[g] > group_free[best])
+      best = g;
+  return best * group_sectors;
 }
 
 /* Allocates CNT consecutive sectors from the free map and stores
@@ -27,16 +83,30 @@ free_map_init (void)
 bool
 free_map_allocate (size_t cnt, block_sector_t *sectorp)
 {
-  block_sector_t sector = bitmap_scan_and_flip (free_map, 0, cnt, false);
+  return free_map_allocate_goal (next_sector, cnt, sectorp);
+}
+
+/* Like free_map_allocate(), but tries to place the sectors at or
+   soon after sector GOAL. */
+bool
+free_map_allocate_goal (block_sector_t goal, size_t cnt,
+                        block_sector_t *sectorp)
+{
+  block_sector_t sector = find_sectors (goal, cnt);
+  if (sector != BITMAP_ERROR)
+    mark_sectors (sector, cnt, true);
   if (sector != BITMAP_ERROR
       && free_map_file != NULL
       && !bitmap_write (free_map, free_map_file))
     {
-      bitmap_set_multiple (free_map, sector, cnt, false); 
+      mark_sectors (sector, cnt, false); 
       sector = BITMAP_ERROR;
     }
-  if (sector != BITMAP_ERROR)
-    *sectorp = sector;
+  if (sector != BITMAP_ERROR) 
+    {
+      *sectorp = sector;
+      next_sector = sector + cnt;
+    }
   return sector != BITMAP_ERROR;
 }
 
@@ -45,7 +115,7 @@ void
 free_map_release (block_sector_t sector, size_t cnt)
 {
   ASSERT (bitmap_all (free_map, sector, cnt));
-  bitmap_set_multiple (free_map, sector, cnt, false);
+  mark_sectors (sector, cnt, false);
   bitmap_write (free_map, free_map_file);
 }
 
@@ -58,6 +128,7 @@ free_map_open (void)
     PANIC ("can't open free map");
   if (!bitmap_read (free_map, free_map_file))
     PANIC ("can't read free map");
+  count_group_free ();
 }
 
 /* Writes the free map to disk and closes the free map file. */
@@ -83,3 +154,93 @@ free_map_create (void)
   if (!bitmap_write (free_map, free_map_file))
     PANIC ("can't write free map");
 }
+
+/* Marks the CNT sectors starting at SECTOR as in use if USED is
+   true, or as free otherwise, and updates the group counts.  The
+   sectors must all currently be in the opposite state. */
+static void
+mark_sectors (block_sector_t sector, size_t cnt, bool used) 
+{
+  bitmap_set_multiple (free_map, sector, cnt, used);
+  while (cnt > 0) 
+    {
+      size_t g = sector / group_sectors;
+      size_t n = group_sectors - sector % group_sectors;
+
+      if (n > cnt)
+        n = cnt;
+      if (used)
+        group_free[g] -= n;
+      else
+        group_free[g] += n;
+      bitmap_set (group_map, g, group_free[g] > 0);
+      sector += n;
+      cnt -= n;
+    }
+}
+
+/* Recomputes the group counts and summary from the free map. */
+static void
+count_group_free (void) 
+{
+  size_t sector_cnt = bitmap_size (free_map);
+  size_t g;
+
+  for (g = 0; g < group_cnt; g++) 
+    {
+      size_t start = g * group_sectors;
+      size_t n = sector_cnt - start < group_sectors
+                 ? sector_cnt - start : group_sectors;
+
+      group_free[g] = bitmap_count (free_map, start, n, false);
+      bitmap_set (group_map, g, group_free[g] > 0);
+    }
+}
+
+/* Returns the first of CNT consecutive free sectors, preferring
+   ones at or soon after GOAL, or BITMAP_ERROR if there are none.
+   Does not allocate them. */
+static block_sector_t
+find_sectors (block_sector_t goal, size_t cnt) 
+{
+  size_t first = goal < bitmap_size (free_map) ? goal / group_sectors : 0;
+  size_t dist = 0;              /* Groups from FIRST to the next to try. */
+
+  /* Visit the groups with free space, starting from GOAL's and
+     wrapping around, each at most once, and look for a run that
+     starts in each one that has enough.  The run may extend into
+     the following groups, but the search stops there, so that a
+     failed search does not cover the rest of the disk again. */
+  while (dist < group_cnt) 
+    {
+      size_t g = bitmap_scan_from_hint (group_map, (first + dist) % group_cnt,
+                                        1, true);
+      size_t sector;
+
+      if (g == BITMAP_ERROR)
+        return BITMAP_ERROR;
+
+      /* Stop if the scan wrapped around to a group already
+         visited. */
+      if ((g + group_cnt - first) % group_cnt < dist)
+        break;
+      dist = (g + group_cnt - first) % group_cnt + 1;
+
+      if (group_free[g] >= cnt || cnt > group_sectors) 
+        {
+          size_t start = g * group_sectors;
+          size_t end = (g + 1) * group_sectors + cnt - 1;
+          if (g == first && goal > start && goal < bitmap_size (free_map))
+            start = goal;
+          if (end > bitmap_size (free_map))
+            end = bitmap_size (free_map);
+          sector = bitmap_scan_range (free_map, start, end, cnt, false);
+          if (sector != BITMAP_ERROR)
+            return sector;
+        }
+    }
+
+  /* No group had room on its own, but a run spanning groups, or
+     one before GOAL in its own group, may still fit. */
+  return bitmap_scan (free_map, 0, cnt, false);
+}
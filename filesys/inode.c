@@ -8,6 +8,8 @@
 #include "filesys/filesys.h"
 #include "filesys/free-map.h"
 #include "threads/malloc.h"
+#include "threads/slab.h"
+#include "userprog/process.h"
 #include "userprog/syscall.h"
 #include "threads/synch.h"
 #include <stdio.h>
@@ -89,8 +91,8 @@ struct inode
 /* --------------------- */
 /* Implemented Functions */
 /* --------------------- */
-bool	fileExtend(struct inode_disk *data, off_t length);
-bool	indirectFileExtend(bool single, bool floor, block_sector_t *block, size_t length);
+bool	fileExtend(struct inode_disk *data, block_sector_t goal, off_t length);
+bool	indirectFileExtend(bool single, bool floor, block_sector_t *block, size_t length, block_sector_t *goal);
 bool	freeInode(struct inode *inode, off_t length);
 bool	indirectFreeInode(bool single, bool floor, block_sector_t block, size_t length);
 
@@ -184,11 +186,15 @@ byte_to_sector (const struct inode *inode, off_t pos)
 	 returns the same `struct inode'. */
 static struct list open_inodes;
 
+/* Cache of struct inode. */
+static struct kmem_cache *inode_cache;
+
 /* Initializes the inode module. */
 void
 inode_init (void) 
 {
 	list_init (&open_inodes);
+	inode_cache = kmem_cache_create ("inode", sizeof (struct inode), NULL);
 }
 
 /* Initializes an inode with LENGTH bytes of data and
@@ -217,7 +223,7 @@ inode_create (block_sector_t sector, off_t length, bool isDirectory)
                 disk_inode->isDirectory = isDirectory;
 		
 		/* Allocate Direct, Indirect, Doubly */
-		if(fileExtend(disk_inode, length))
+		if(fileExtend(disk_inode, sector + 1, length))
 		{
 			block_write (fs_device, sector, disk_inode);
 			/*
@@ -260,7 +266,7 @@ inode_open (block_sector_t sector)
 		}
 
 	/* Allocate memory. */
-	inode = malloc (sizeof *inode);
+	inode = kmem_cache_alloc (inode_cache);
 	if (inode == NULL)
 		return NULL;
 
@@ -320,7 +326,7 @@ inode_close (struct inode *inode)
 					);
 				}
 
-			free (inode); 
+			kmem_cache_free (inode_cache, inode); 
 		}
 }
 
@@ -331,6 +337,7 @@ inode_remove (struct inode *inode)
 {
 	ASSERT (inode != NULL);
 	inode->removed = true;
+	process_image_changed (inode->sector, true);
 }
 
 /* Reads SIZE bytes from INODE into BUFFER, starting at position OFFSET.
@@ -389,6 +396,37 @@ inode_read_at (struct inode *inode, void *buffer_, off_t size, off_t offset)
 	return bytes_read;
 }
 
+/* Makes INODE at least LENGTH bytes long, if it is not already.
+	 Returns false if there is no space to extend it. */
+static bool
+extend_inode (struct inode *inode, off_t length)
+{
+	// Current file too small : Need to extend file
+	if( (byte_to_sector(inode, length) == (block_sector_t) -1)
+			&& (inode_length(inode) < length) ) {
+		
+		/* Access to independent files/directories should not block each other */
+		if(!(inode->isDirectory)) {
+			lock_acquire(&((struct inode *)inode)->lock);
+		}
+		
+		/* Call file extend function, 
+		returns -1 if unable to get any more space */
+		bool get = fileExtend(&inode->data, inode->sector + 1, length);
+		
+		// Update inode information
+		if(get) { inode -> data.length = length; }
+		
+		if(!(inode->isDirectory)) {
+			lock_release(&((struct inode *)inode)->lock);
+		}
+		
+		// Unable to get space
+		if(!get) { return false; }
+	}
+	return true;
+}
+
 /* Writes SIZE bytes from BUFFER into INODE, starting at OFFSET.
 	 Returns the number of bytes actually written, which may be
 	 less than SIZE if end of file is reached or an error occurs.
@@ -407,31 +445,7 @@ inode_write_at (
 	/* Extend inode if write is outside of file */
 	/* ---------------------------------------- */
 	if(size < 0 || offset < 0) {return 0;}
-	off_t totalLength = offset + size;
-	int extend = byte_to_sector(inode, totalLength);
-	
-	// Current file too small : Need to extend file
-	if( (extend == -1) && (inode_length(inode) < totalLength) ) {
-		
-		/* Access to independent files/directories should not block each other */
-		if(!(inode->isDirectory)) {
-			lock_acquire(&((struct inode *)inode)->lock);
-		}
-		
-		/* Call file extend function, 
-		returns -1 if unable to get any more space */
-		bool get = fileExtend(&inode->data, totalLength);
-		
-		// Unable to get space
-		if(!get) { return 0; }
-		
-		// Update inode information
-		inode -> data.length = totalLength;
-		
-		if(!(inode->isDirectory)) {
-			lock_release(&((struct inode *)inode)->lock);
-		}
-	}
+	if(!extend_inode(inode, offset + size)) {return 0;}
 	
 	const uint8_t *buffer = buffer_;
 	off_t bytes_written = 0;
@@ -492,6 +506,59 @@ inode_write_at (
 	return bytes_written;
 }
 
+/* Copies up to LENGTH bytes from SRC, starting at SRC_OFS, into
+	 DST, starting at DST_OFS, a sector at a time through a kernel
+	 buffer.  If the copy runs past the end of DST, extends DST to
+	 its final size in one step first.  Returns the number of bytes
+	 actually copied, which is less than LENGTH at the end of SRC or
+	 if an error occurs.  The source and destination ranges must not
+	 overlap. */
+off_t
+inode_copy (struct inode *dst, off_t dst_ofs,
+						struct inode *src, off_t src_ofs, off_t length)
+{
+	uint8_t *buffer;
+	off_t bytes_copied = 0;
+
+	if (length <= 0 || dst_ofs < 0 || src_ofs < 0
+			|| src_ofs >= inode_length (src) || dst->deny_write_cnt)
+		return 0;
+	if (length > inode_length (src) - src_ofs)
+		length = inode_length (src) - src_ofs;
+	if (!extend_inode (dst, dst_ofs + length))
+		return 0;
+
+	buffer = malloc (BLOCK_SECTOR_SIZE);
+	if (buffer == NULL)
+		return 0;
+	while (bytes_copied < length) 
+		{
+			/* Stop each chunk at a destination sector boundary, so
+				 that whole sectors are written without reading them
+				 first. */
+			int sector_left = BLOCK_SECTOR_SIZE - dst_ofs % BLOCK_SECTOR_SIZE;
+			off_t chunk_size = length - bytes_copied;
+			off_t n;
+
+			if (chunk_size > sector_left)
+				chunk_size = sector_left;
+			n = inode_read_at (src, buffer, chunk_size, src_ofs);
+			if (n > 0)
+				n = inode_write_at (dst, buffer, n, dst_ofs);
+			if (n <= 0)
+				break;
+
+			src_ofs += n;
+			dst_ofs += n;
+			bytes_copied += n;
+			if (n < chunk_size)
+				break;
+		}
+	free (buffer);
+
+	return bytes_copied;
+}
+
 /* Disables writes to INODE.
 	 May be called at most once per inode opener. */
 void
@@ -510,6 +577,12 @@ inode_allow_write (struct inode *inode)
 	ASSERT (inode->deny_write_cnt > 0);
 	ASSERT (inode->deny_write_cnt <= inode->open_cnt);
 	inode->deny_write_cnt--;
+
+	/* Executables are cached only while writes to them are
+		 denied, so this is the only point at which a cached one
+		 can start to go stale. */
+	if (inode->deny_write_cnt == 0)
+		process_image_changed (inode->sector, false);
 }
 
 /* Returns the length, in bytes, of INODE's data. */
@@ -524,9 +597,14 @@ inode_length (const struct inode *inode)
 	Searches Direct -> Indirect -> Doubly Indirect
 	for available ('0' value) sectors until 'length' 
 	# of sectors have been allocated.
+	
+	New sectors are placed as close as possible after 'goal'
+	(normally the inode's own sector), or after the last
+	sector already allocated to the file, so that a file's
+	data follows its inode on disk.
 */
 bool 
-fileExtend(struct inode_disk *data, off_t length) 
+fileExtend(struct inode_disk *data, block_sector_t goal, off_t length) 
 {	
 	// Create a file of 0 means don't create anything
 	bool pass = false;
@@ -562,7 +640,7 @@ fileExtend(struct inode_disk *data, off_t length)
 		if(!data->direct[headSector]) {
 			
 			// Single available Direct Sector block found. Use it.
-			if(free_map_allocate(1, &data->direct[headSector])) {
+			if(free_map_allocate_goal(goal, 1, &data->direct[headSector])) {
 				pass = true; 
 				
 				// Write into newly allocated block
@@ -570,6 +648,9 @@ fileExtend(struct inode_disk *data, off_t length)
 			}
 			else { return false; }
 		}
+		
+		// Next block goes right after this one
+		goal = data->direct[headSector] + 1;
 	}
 	
 	// If no more sectors to meet 'length' # of sectors, extension success
@@ -581,7 +662,7 @@ fileExtend(struct inode_disk *data, off_t length)
 		tailSector = remainingSectors; }
 	else {tailSector = MAX_INDIRECT;}
 	
-	pass = indirectFileExtend(true, false, &data->indirect, tailSector);
+	pass = indirectFileExtend(true, false, &data->indirect, tailSector, &goal);
 	
 	// Did it fail Indirect extend?
 	if(!pass) return pass;
@@ -595,7 +676,7 @@ fileExtend(struct inode_disk *data, off_t length)
 		tailSector = remainingSectors; }
 	else {tailSector = MAX_DOUBLY_INDIRECT;}
 	
-	pass = indirectFileExtend(false, false, &data->doubly_indirect, tailSector);
+	pass = indirectFileExtend(false, false, &data->doubly_indirect, tailSector, &goal);
 	
 	// Special case : Perfectly allocates and fills all available sectors
 	if(!(remainingSectors - tailSector)) { return true; }
@@ -609,9 +690,12 @@ fileExtend(struct inode_disk *data, off_t length)
 	for available ('0' value) sectors until 'length' 
 	# of sectors have been allocated.
 	'floor' will be true once done allocating all blocks
+	'goal' is where to look for the next free sector; it is
+	moved past each block visited.
 */
 bool
-indirectFileExtend(bool single, bool floor, block_sector_t* block, size_t length)
+indirectFileExtend(bool single, bool floor, block_sector_t* block, size_t length,
+		block_sector_t *goal)
 {	
 	// Extend and search indexes or indexes of indexes
 	bool pass = false;
@@ -636,22 +720,24 @@ indirectFileExtend(bool single, bool floor, block_sector_t* block, size_t length
 	if(floor) {
 		// Free block. Allocate
 		if(!(*block)) {
-			if(free_map_allocate(1, block)) {	
+			if(free_map_allocate_goal(*goal, 1, block)) {	
 				block_write(fs_device, *block, zeros);
+				*goal = *block + 1;
 				return true;
 			}
 			return false;
 		}
-		else { return true; }
+		else { *goal = *block + 1; return true; }
 	}
 	
 	// Fill before reading from 'block'
 	if(!(*block)) {
-		if(free_map_allocate(1, block)) {	
+		if(free_map_allocate_goal(*goal, 1, block)) {	
 			block_write(fs_device, *block, zeros);
 		}
 		else { return false; }
 	}
+	*goal = *block + 1;
 	
 	// Get table of indexes, or table of indexes of indexes
 	block_read(fs_device, *block, &indirectSearch);
@@ -668,11 +754,11 @@ indirectFileExtend(bool single, bool floor, block_sector_t* block, size_t length
 		block_sector_t* current = &indirectSearch.indirect[headSector];
 		
 		if(single) {
-			pass = indirectFileExtend(true, true, current, remainingSectors);
+			pass = indirectFileExtend(true, true, current, remainingSectors, goal);
 		}
 		// Doubly Indirect are just indices with Indirect Blocks
 		else {
-			pass = indirectFileExtend(true, false, current, remainingSectors);
+			pass = indirectFileExtend(true, false, current, remainingSectors, goal);
 		}
 		
 		if(!pass) return false;
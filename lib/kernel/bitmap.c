@@ -69,6 +69,41 @@ last_mask (const struct bitmap *b)
   return last_bits ? ((elem_type) 1 << last_bits) - 1 : (elem_type) -1;
 }
 
+/* Returns the index of the lowest set bit in ELEM, which must be
+   nonzero.  Compiles to a single BSF instruction. */
+static inline size_t
+lowest_bit (elem_type elem) 
+{
+  return __builtin_ctzl (elem);
+}
+
+/* Returns the index of the first bit in B at or after START and
+   before LIMIT that is set to VALUE, or LIMIT if there is none.
+   Skips whole elements that contain no such bit. */
+static size_t
+next_bit (const struct bitmap *b, size_t start, size_t limit, bool value) 
+{
+  elem_type flip = value ? 0 : (elem_type) -1;
+  size_t idx = elem_idx (start);
+  size_t end = elem_cnt (limit);
+  elem_type elem;
+
+  if (start >= limit)
+    return limit;
+
+  /* Ignore the bits before START in its element. */
+  elem = (b->bits[idx] ^ flip) & ~(bit_mask (start) - 1);
+  while (elem == 0) 
+    {
+      if (++idx >= end)
+        return limit;
+      elem = b->bits[idx] ^ flip;
+    }
+
+  start = idx * ELEM_BITS + lowest_bit (elem);
+  return start < limit ? start : limit;
+}
+
 /* Creation and destruction. */
 
 /* Creates and returns a pointer to a newly allocated bitmap with room for
@@ -217,14 +252,30 @@ bitmap_set_all (struct bitmap *b, bool value)
 void
 bitmap_set_multiple (struct bitmap *b, size_t start, size_t cnt, bool value) 
 {
-  size_t i;
+  size_t end = start + cnt;
   
   ASSERT (b != NULL);
   ASSERT (start <= b->bit_cnt);
   ASSERT (start + cnt <= b->bit_cnt);
 
-  for (i = 0; i < cnt; i++)
-    bitmap_set (b, start + i, value);
+  /* Update a whole element at a time, atomically, as in
+     bitmap_mark() and bitmap_reset(). */
+  while (start < end) 
+    {
+      size_t idx = elem_idx (start);
+      size_t bits = ELEM_BITS - start % ELEM_BITS;
+      elem_type mask;
+
+      if (bits > end - start)
+        bits = end - start;
+      mask = (bits == ELEM_BITS ? (elem_type) -1
+              : (((elem_type) 1 << bits) - 1) << (start % ELEM_BITS));
+      if (value)
+        asm ("orl %1, %0" : "=m" (b->bits[idx]) : "r" (mask) : "cc");
+      else
+        asm ("andl %1, %0" : "=m" (b->bits[idx]) : "r" (~mask) : "cc");
+      start += bits;
+    }
 }
 
 /* Returns the number of bits in B between START and START + CNT,
@@ -250,16 +301,11 @@ bitmap_count (const struct bitmap *b, size_t start, size_t cnt, bool value)
 bool
 bitmap_contains (const struct bitmap *b, size_t start, size_t cnt, bool value) 
 {
-  size_t i;
-  
   ASSERT (b != NULL);
   ASSERT (start <= b->bit_cnt);
   ASSERT (start + cnt <= b->bit_cnt);
 
-  for (i = 0; i < cnt; i++)
-    if (bitmap_test (b, start + i) == value)
-      return true;
-  return false;
+  return cnt > 0 && next_bit (b, start, start + cnt, value) < start + cnt;
 }
 
 /* Returns true if any bits in B between START and START + CNT,
@@ -296,19 +342,65 @@ size_t
 bitmap_scan (const struct bitmap *b, size_t start, size_t cnt, bool value) 
 {
   ASSERT (b != NULL);
-  ASSERT (start <= b->bit_cnt);
 
-  if (cnt <= b->bit_cnt) 
+  return bitmap_scan_range (b, start, b->bit_cnt, cnt, value);
+}
+
+/* Like bitmap_scan(), but only finds groups that lie entirely
+   between START and END, exclusive. */
+size_t
+bitmap_scan_range (const struct bitmap *b, size_t start, size_t end,
+                   size_t cnt, bool value) 
+{
+  ASSERT (b != NULL);
+  ASSERT (start <= end);
+  ASSERT (end <= b->bit_cnt);
+
+  if (cnt == 0)
+    return start;
+  if (cnt <= end - start) 
     {
-      size_t last = b->bit_cnt - cnt;
-      size_t i;
-      for (i = start; i <= last; i++)
-        if (!bitmap_contains (b, i, cnt, !value))
-          return i; 
+      size_t last = end - cnt;
+
+      /* Jump from the start of each run of VALUE bits to its end,
+         until a run is long enough. */
+      while (start <= last) 
+        {
+          size_t run_end;
+
+          start = next_bit (b, start, last + 1, value);
+          if (start > last)
+            break;
+          run_end = next_bit (b, start, end, !value);
+          if (run_end - start >= cnt)
+            return start;
+          start = run_end;
+        }
     }
   return BITMAP_ERROR;
 }
 
+/* Like bitmap_scan(), but starts looking at HINT and, if that
+   fails, wraps around to the beginning of B.  Callers that pass
+   the end of the previous group found get next-fit allocation,
+   which avoids rescanning the full part of the bitmap each
+   time.  HINT may be any value; it is reduced modulo B's size. */
+size_t
+bitmap_scan_from_hint (const struct bitmap *b, size_t hint, size_t cnt,
+                       bool value) 
+{
+  size_t idx;
+
+  ASSERT (b != NULL);
+
+  if (hint >= b->bit_cnt)
+    hint = 0;
+  idx = bitmap_scan (b, hint, cnt, value);
+  if (idx == BITMAP_ERROR && hint > 0)
+    idx = bitmap_scan (b, 0, cnt, value);
+  return idx;
+}
+
 /* Finds the first group of CNT consecutive bits in B at or after
    START that are all set to VALUE, flips them all to !VALUE,
    and returns the index of the first bit in the group.
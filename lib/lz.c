@@ -0,0 +1,171 @@
+#include <lz.h>
+#include <debug.h>
+#include <stdbool.h>
+#include <string.h>
+
+/* Compressed data is a sequence of items, each introduced by a
+   control byte CTRL:
+
+     - CTRL < 32: a run of CTRL + 1 literal bytes follows.
+
+     - Otherwise, a back-reference: copy LEN + 2 bytes starting
+       OFS + 1 bytes back in the output, where LEN is CTRL >> 5
+       (plus the following byte, if LEN is 7) and OFS is
+       (CTRL & 0x1f) << 8 plus the byte after that.
+
+   So literal runs are at most 32 bytes, matches are 3 to 264
+   bytes long, and they reach back at most 8 kB. */
+
+#define MAX_LITERAL 32
+#define MIN_MATCH 3
+#define MAX_MATCH (7 + 255 + 2)
+#define MAX_OFFSET (1 << 13)
+
+#define HASH_BITS 12
+
+/* Hashes the 3 bytes at P. */
+static inline unsigned
+hash3 (const uint8_t *p) 
+{
+  uint32_t v = (p[0] << 16) | (p[1] << 8) | p[2];
+  return ((v * 2654435761u) >> (32 - HASH_BITS)) & ((1 << HASH_BITS) - 1);
+}
+
+/* Appends CNT literal bytes from SRC at *OP, which may not pass
+   OP_END.  Returns false if there is not enough room. */
+static bool
+put_literals (uint8_t **op, uint8_t *op_end, const uint8_t *src, size_t cnt) 
+{
+  while (cnt > 0) 
+    {
+      size_t run = cnt < MAX_LITERAL ? cnt : MAX_LITERAL;
+      if ((size_t) (op_end - *op) < run + 1)
+        return false;
+      *(*op)++ = run - 1;
+      memcpy (*op, src, run);
+      *op += run;
+      src += run;
+      cnt -= run;
+    }
+  return true;
+}
+
+/* Compresses the SRC_SIZE bytes at SRC into the DST_SIZE bytes
+   at DST, using the LZ_WORK_SIZE bytes at WORK as scratch space.
+   Returns the size of the compressed data, or 0 if it would not
+   fit in DST_SIZE bytes.  SRC_SIZE may be at most
+   LZ_MAX_INPUT. */
+size_t
+lz_compress (const void *src_, size_t src_size,
+             void *dst_, size_t dst_size, void *work) 
+{
+  const uint8_t *src = src_;
+  const uint8_t *ip = src;
+  const uint8_t *end = src + src_size;
+  const uint8_t *lit = src;             /* Start of pending literals. */
+  uint8_t *dst = dst_;
+  uint8_t *op = dst;
+  uint8_t *op_end = dst + dst_size;
+  uint16_t *htab = work;
+
+  ASSERT (src_size <= LZ_MAX_INPUT);
+
+  /* HTAB maps a hash of 3 bytes to the last position where they
+     were seen.  It is not cleared first: a stale entry is caught
+     by the position check or by comparing the bytes. */
+  while (end - ip >= MIN_MATCH) 
+    {
+      unsigned h = hash3 (ip);
+      size_t pos = ip - src;
+      size_t ref = htab[h];
+      htab[h] = pos;
+
+      if (ref < pos && pos - ref <= MAX_OFFSET
+          && src[ref] == ip[0] && src[ref + 1] == ip[1]
+          && src[ref + 2] == ip[2]) 
+        {
+          size_t max = end - ip < MAX_MATCH ? (size_t) (end - ip) : MAX_MATCH;
+          size_t len = MIN_MATCH;
+          size_t ofs = pos - ref - 1;
+
+          while (len < max && src[ref + len] == ip[len])
+            len++;
+
+          if (!put_literals (&op, op_end, lit, ip - lit)
+              || op_end - op < 3)
+            return 0;
+          if (len - 2 < 7)
+            *op++ = ((len - 2) << 5) | (ofs >> 8);
+          else 
+            {
+              *op++ = (7 << 5) | (ofs >> 8);
+              *op++ = len - 2 - 7;
+            }
+          *op++ = ofs & 0xff;
+
+          ip += len;
+          lit = ip;
+        }
+      else
+        ip++;
+    }
+
+  if (!put_literals (&op, op_end, lit, end - lit))
+    return 0;
+  return op - dst;
+}
+
+/* Decompresses the SRC_SIZE bytes of lz_compress() output at SRC
+   into the DST_SIZE bytes at DST.  Returns the size of the
+   decompressed data, or 0 if SRC is corrupt or its contents do
+   not fit in DST_SIZE bytes. */
+size_t
+lz_decompress (const void *src_, size_t src_size,
+               void *dst_, size_t dst_size) 
+{
+  const uint8_t *ip = src_;
+  const uint8_t *end = ip + src_size;
+  uint8_t *dst = dst_;
+  uint8_t *op = dst;
+  uint8_t *op_end = dst + dst_size;
+
+  while (ip < end) 
+    {
+      unsigned ctrl = *ip++;
+
+      if (ctrl < MAX_LITERAL) 
+        {
+          size_t run = ctrl + 1;
+          if ((size_t) (end - ip) < run || (size_t) (op_end - op) < run)
+            return 0;
+          memcpy (op, ip, run);
+          ip += run;
+          op += run;
+        }
+      else 
+        {
+          size_t len = ctrl >> 5;
+          size_t ofs;
+          const uint8_t *ref;
+
+          if (len == 7) 
+            {
+              if (ip >= end)
+                return 0;
+              len += *ip++;
+            }
+          if (ip >= end)
+            return 0;
+          ofs = ((ctrl & 0x1f) << 8) + *ip++ + 1;
+          len += 2;
+          if (ofs > (size_t) (op - dst) || (size_t) (op_end - op) < len)
+            return 0;
+
+          /* The source and destination may overlap, so copy one
+             byte at a time. */
+          for (ref = op - ofs; len > 0; len--)
+            *op++ = *ref++;
+        }
+    }
+  return op - dst;
+}
@@ -0,0 +1,23 @@
+#ifndef __LIB_LZ_H
+#define __LIB_LZ_H
+
+/* A small, fast LZ77-family compressor in the style of LZF.
+   It trades compression ratio for speed, which makes it suitable
+   for compressing pages of memory on the fly. */
+
+#include <stddef.h>
+#include <stdint.h>
+
+/* Bytes of scratch space that lz_compress() needs.  The contents
+   need not be initialized and may be reused between calls. */
+#define LZ_WORK_SIZE (sizeof (uint16_t) << 12)
+
+/* Largest input that lz_compress() accepts. */
+#define LZ_MAX_INPUT 65535
+
+size_t lz_compress (const void *src, size_t src_size,
+                    void *dst, size_t dst_size, void *work);
+size_t lz_decompress (const void *src, size_t src_size,
+                      void *dst, size_t dst_size);
+
+#endif /* lib/lz.h */
@@ -1,5 +1,22 @@
 #include <string.h>
 #include <debug.h>
+#include <stdint.h>
+
+/* The block functions below work a 32-bit word at a time, using
+   the x86 string instructions for bulk copies and fills.  Below
+   this many bytes, the setup costs more than it saves and they
+   just loop over bytes. */
+#define SHORT_BLOCK 16
+
+/* A word that may alias any other type, for reading and writing
+   memory of arbitrary type a word at a time. */
+typedef uint32_t word_t __attribute__ ((may_alias));
+
+/* Word with every byte set to 0x01. */
+#define ONES 0x01010101u
+
+/* Nonzero if word W contains a zero byte. */
+#define HAS_ZERO(W) (((W) - ONES) & ~(W) & (ONES << 7))
 
 /* Copies SIZE bytes from SRC to DST, which must not overlap.
    Returns DST. */
@@ -12,8 +29,22 @@ memcpy (void *dst_, const void *src_, size_t size)
   ASSERT (dst != NULL || size == 0);
   ASSERT (src != NULL || size == 0);
 
-  while (size-- > 0)
-    *dst++ = *src++;
+  if (size >= SHORT_BLOCK) 
+    {
+      /* Align DST, then copy words, then the leftover bytes. */
+      size_t head = -(uintptr_t) dst & 3;
+      size_t words;
+
+      size -= head;
+      words = size / 4;
+      size %= 4;
+      asm volatile ("rep movsb"
+                    : "+D" (dst), "+S" (src), "+c" (head) : : "memory");
+      asm volatile ("rep movsl"
+                    : "+D" (dst), "+S" (src), "+c" (words) : : "memory");
+    }
+  asm volatile ("rep movsb"
+                : "+D" (dst), "+S" (src), "+c" (size) : : "memory");
 
   return dst_;
 }
@@ -29,20 +60,30 @@ memmove (void *dst_, const void *src_, size_t size)
   ASSERT (dst != NULL || size == 0);
   ASSERT (src != NULL || size == 0);
 
-  if (dst < src) 
+  if (dst <= src || dst >= src + size) 
     {
-      while (size-- > 0)
-        *dst++ = *src++;
+      /* Copying upward is safe even if the blocks overlap,
+         because the string instructions move one element at a
+         time and each source word is read before it can be
+         overwritten. */
+      return memcpy (dst_, src_, size);
     }
-  else 
+
+  /* Copy downward.  Leave the direction flag alone, since an
+     interrupt handler could run while it is set, and move whole
+     words while at least one remains. */
+  dst += size;
+  src += size;
+  for (; size >= 4; size -= 4) 
     {
-      dst += size;
-      src += size;
-      while (size-- > 0)
-        *--dst = *--src;
+      dst -= 4;
+      src -= 4;
+      *(word_t *) dst = *(const word_t *) src;
     }
+  while (size-- > 0)
+    *--dst = *--src;
 
-  return dst;
+  return dst_;
 }
 
 /* Find the first differing byte in the two blocks of SIZE bytes
@@ -58,6 +99,10 @@ memcmp (const void *a_, const void *b_, size_t size)
   ASSERT (a != NULL || size == 0);
   ASSERT (b != NULL || size == 0);
 
+  /* Skip over equal words, then find the differing byte. */
+  for (; size >= 4; size -= 4, a += 4, b += 4)
+    if (*(const word_t *) a != *(const word_t *) b)
+      break;
   for (; size-- > 0; a++, b++)
     if (*a != *b)
       return *a > *b ? +1 : -1;
@@ -281,9 +326,24 @@ memset (void *dst_, int value, size_t size)
   unsigned char *dst = dst_;
 
   ASSERT (dst != NULL || size == 0);
-  
-  while (size-- > 0)
-    *dst++ = value;
+
+  if (size >= SHORT_BLOCK) 
+    {
+      /* Align DST, then store words, then the leftover bytes. */
+      size_t head = -(uintptr_t) dst & 3;
+      size_t words;
+      uint32_t fill = (unsigned char) value * ONES;
+
+      size -= head;
+      words = size / 4;
+      size %= 4;
+      asm volatile ("rep stosb"
+                    : "+D" (dst), "+c" (head) : "a" (fill) : "memory");
+      asm volatile ("rep stosl"
+                    : "+D" (dst), "+c" (words) : "a" (fill) : "memory");
+    }
+  asm volatile ("rep stosb"
+                : "+D" (dst), "+c" (size) : "a" (value) : "memory");
 
   return dst_;
 }
@@ -296,8 +356,16 @@ strlen (const char *string)
 
   ASSERT (string != NULL);
 
-  for (p = string; *p != '\0'; p++)
-    continue;
+  /* Check bytes up to a word boundary, then whole words.  An
+     aligned word never straddles a page boundary, so reading a
+     few bytes past the null terminator cannot fault. */
+  for (p = string; (uintptr_t) p & 3; p++)
+    if (*p == '\0')
+      return p - string;
+  while (!HAS_ZERO (*(const word_t *) p))
+    p += 4;
+  while (*p != '\0')
+    p++;
   return p - string;
 }
 
@@ -1,65 +1,83 @@
 #include <syscall.h>
+#include <stdbool.h>
+#include <stdint.h>
 #include "../syscall-nr.h"
 
+/* Returns true if the CPU supports SYSENTER.  Checked once. */
+static bool
+have_sysenter (void) 
+{
+  static int known = -1;
+
+  if (known < 0) 
+    {
+      uint32_t eax = 1, ebx, ecx, edx;
+      asm ("cpuid" : "+a" (eax), "=b" (ebx), "=c" (ecx), "=d" (edx));
+      known = (edx & (1u << 11)) != 0;
+    }
+  return known;
+}
+
+/* Invokes syscall NUMBER, passing arguments ARG0 through ARG3,
+   and returns the return value as an `int'.  The kernel ignores
+   arguments that the system call does not take.
+
+   Uses SYSENTER if the CPU has it, passing the arguments in
+   registers: the number in %eax, the arguments in %ebx, %esi,
+   %edi, and %ebp, our stack pointer in %ecx, and the address to
+   return to in %edx.  %ebp may be the frame pointer, so it is
+   saved on the stack around the call, and ARG3 goes through %ecx
+   to get into it.  Otherwise, falls back to `int $0x30' with the
+   number and arguments pushed on the stack. */
+static inline int
+syscall (int number, int arg0, int arg1, int arg2, int arg3) 
+{
+  int retval;
+
+  if (have_sysenter ())
+    asm volatile
+      ("pushl %%ebp; movl %%ecx, %%ebp; "
+       "movl %%esp, %%ecx; movl $1f, %%edx; sysenter; 1: popl %%ebp"
+         : "=a" (retval), "+c" (arg3)
+         : "a" (number), "b" (arg0), "S" (arg1), "D" (arg2)
+         : "edx", "cc", "memory");
+  else
+    asm volatile
+      ("pushl %[arg3]; pushl %[arg2]; pushl %[arg1]; pushl %[arg0]; "
+       "pushl %[number]; int $0x30; addl $20, %%esp"
+         : "=a" (retval)
+         : [number] "r" (number),
+           [arg0] "r" (arg0),
+           [arg1] "r" (arg1),
+           [arg2] "r" (arg2),
+           [arg3] "r" (arg3)
+         : "memory");
+  return retval;
+}
+
 /* Invokes syscall NUMBER, passing no arguments, and returns the
    return value as an `int'. */
-#define syscall0(NUMBER)                                        \
-        ({                                                      \
-          int retval;                                           \
-          asm volatile                                          \
-            ("pushl %[number]; int $0x30; addl $4, %%esp"       \
-               : "=a" (retval)                                  \
-               : [number] "i" (NUMBER)                          \
-               : "memory");                                     \
-          retval;                                               \
-        })
+#define syscall0(NUMBER) syscall (NUMBER, 0, 0, 0, 0)
 
 /* Invokes syscall NUMBER, passing argument ARG0, and returns the
    return value as an `int'. */
-#define syscall1(NUMBER, ARG0)                                           \
-        ({                                                               \
-          int retval;                                                    \
-          asm volatile                                                   \
-            ("pushl %[arg0]; pushl %[number]; int $0x30; addl $8, %%esp" \
-               : "=a" (retval)                                           \
-               : [number] "i" (NUMBER),                                  \
-                 [arg0] "g" (ARG0)                                       \
-               : "memory");                                              \
-          retval;                                                        \
-        })
+#define syscall1(NUMBER, ARG0) syscall (NUMBER, (int) (ARG0), 0, 0, 0)
 
 /* Invokes syscall NUMBER, passing arguments ARG0 and ARG1, and
    returns the return value as an `int'. */
-#define syscall2(NUMBER, ARG0, ARG1)                            \
-        ({                                                      \
-          int retval;                                           \
-          asm volatile                                          \
-            ("pushl %[arg1]; pushl %[arg0]; "                   \
-             "pushl %[number]; int $0x30; addl $12, %%esp"      \
-               : "=a" (retval)                                  \
-               : [number] "i" (NUMBER),                         \
-                 [arg0] "r" (ARG0),                             \
-                 [arg1] "r" (ARG1)                              \
-               : "memory");                                     \
-          retval;                                               \
-        })
+#define syscall2(NUMBER, ARG0, ARG1) \
+        syscall (NUMBER, (int) (ARG0), (int) (ARG1), 0, 0)
 
 /* Invokes syscall NUMBER, passing arguments ARG0, ARG1, and
    ARG2, and returns the return value as an `int'. */
-#define syscall3(NUMBER, ARG0, ARG1, ARG2)                      \
-        ({                                                      \
-          int retval;                                           \
-          asm volatile                                          \
-            ("pushl %[arg2]; pushl %[arg1]; pushl %[arg0]; "    \
-             "pushl %[number]; int $0x30; addl $16, %%esp"      \
-               : "=a" (retval)                                  \
-               : [number] "i" (NUMBER),                         \
-                 [arg0] "r" (ARG0),                             \
-                 [arg1] "r" (ARG1),                             \
-                 [arg2] "r" (ARG2)                              \
-               : "memory");                                     \
-          retval;                                               \
-        })
+#define syscall3(NUMBER, ARG0, ARG1, ARG2) \
+        syscall (NUMBER, (int) (ARG0), (int) (ARG1), (int) (ARG2), 0)
+
+/* Invokes syscall NUMBER, passing arguments ARG0 through ARG3,
+   and returns the return value as an `int'. */
+#define syscall4(NUMBER, ARG0, ARG1, ARG2, ARG3)                  \
+        syscall (NUMBER, (int) (ARG0), (int) (ARG1), (int) (ARG2), \
+                 (int) (ARG3))
 
 void
 halt (void) 
@@ -182,3 +200,57 @@ inumber (int fd)
 {
   return syscall1 (SYS_INUMBER, fd);
 }
+
+pid_t
+fork (void)
+{
+  return (pid_t) syscall0 (SYS_FORK);
+}
+
+int
+pread (int fd, void *buffer, unsigned size, int offset)
+{
+  return syscall4 (SYS_PREAD, fd, buffer, size, offset);
+}
+
+int
+pwrite (int fd, const void *buffer, unsigned size, int offset)
+{
+  return syscall4 (SYS_PWRITE, fd, buffer, size, offset);
+}
+
+int
+readv (int fd, const struct iovec *iov, int iovcnt)
+{
+  return syscall3 (SYS_READV, fd, iov, iovcnt);
+}
+
+int
+writev (int fd, const struct iovec *iov, int iovcnt)
+{
+  return syscall3 (SYS_WRITEV, fd, iov, iovcnt);
+}
+
+int
+copy_file_range (int in_fd, int out_fd, unsigned length)
+{
+  return syscall3 (SYS_COPY_FILE_RANGE, in_fd, out_fd, length);
+}
+
+int
+getdents (int fd, struct dirent *buffer, unsigned size)
+{
+  return syscall3 (SYS_GETDENTS, fd, buffer, size);
+}
+
+bool
+stat (const char *file, struct stat *st)
+{
+  return syscall2 (SYS_STAT, file, st);
+}
+
+bool
+fstat (int fd, struct stat *st)
+{
+  return syscall2 (SYS_FSTAT, fd, st);
+}
@@ -0,0 +1,175 @@
+/* Test program for lib/lz.c.
+
+   Compresses and decompresses pages of random, zero, repetitive,
+   and text-like data and checks that each comes back unchanged,
+   then checks that lz_decompress() rejects truncated and corrupt
+   input instead of overrunning its buffers.
+
+   This is not a test we will run on your submitted projects.
+   It is here for completeness.
+*/
+
+#undef NDEBUG
+#include <debug.h>
+#include <lz.h>
+#include <random.h>
+#include <stdio.h>
+#include <string.h>
+#include "threads/test.h"
+#include "threads/vaddr.h"
+
+/* Room for the compressed form of any page: in the worst case,
+   one control byte per 32 literal bytes. */
+#define MAX_COMPRESSED (PGSIZE + PGSIZE / 32)
+
+static uint8_t page[PGSIZE];
+static uint8_t packed[MAX_COMPRESSED];
+static uint8_t unpacked[PGSIZE + 1];
+static uint8_t work[LZ_WORK_SIZE];
+
+static void fill_random (void);
+static void fill_zero (void);
+static void fill_repetitive (void);
+static void fill_text (void);
+static void check_round_trip (const char *name, bool compressible);
+static void check_corrupt (void);
+
+/* Test the compressor. */
+void
+test (void)
+{
+  printf ("checking random pages...\n");
+  fill_random ();
+  check_round_trip ("random", false);
+  printf ("checking zero pages...\n");
+  fill_zero ();
+  check_round_trip ("zero", true);
+  printf ("checking repetitive pages...\n");
+  fill_repetitive ();
+  check_round_trip ("repetitive", true);
+  printf ("checking text-like pages...\n");
+  fill_text ();
+  check_round_trip ("text", true);
+  printf ("checking corrupt input...\n");
+  check_corrupt ();
+  printf ("done\n");
+}
+
+/* Fills page with random bytes, which do not compress. */
+static void
+fill_random (void)
+{
+  random_bytes (page, sizeof page);
+}
+
+/* Fills page with zeros. */
+static void
+fill_zero (void)
+{
+  memset (page, 0, sizeof page);
+}
+
+/* Fills page with a short random pattern, repeated. */
+static void
+fill_repetitive (void)
+{
+  size_t period = random_ulong () % 64 + 1;
+  size_t i;
+
+  random_bytes (page, period);
+  for (i = period; i < sizeof page; i++)
+    page[i] = page[i - period];
+}
+
+/* Fills page with random bytes from a small alphabet, mostly
+   copying earlier stretches, a little like text. */
+static void
+fill_text (void)
+{
+  size_t i = 0;
+
+  while (i < sizeof page)
+    {
+      size_t len = random_ulong () % 16 + 1;
+
+      if (len > sizeof page - i)
+        len = sizeof page - i;
+      if (i > 320 && random_ulong () % 4 != 0)
+        memmove (page + i, page + i - random_ulong () % 300 - len, len);
+      else
+        {
+          size_t j;
+          for (j = 0; j < len; j++)
+            page[i + j] = "etaoin shrdlu"[random_ulong () % 13];
+        }
+      i += len;
+    }
+}
+
+/* Compresses page and checks that it decompresses to the same
+   bytes.  If COMPRESSIBLE, also checks that it shrank enough for
+   vm/zcache.c to keep it, to 3/4 of a page; otherwise, checks
+   that compressing into a buffer that small fails cleanly. */
+static void
+check_round_trip (const char *name, bool compressible)
+{
+  size_t size = lz_compress (page, sizeof page, packed, sizeof packed, work);
+
+  ASSERT (size > 0);
+  printf ("%s page: %zu bytes compressed\n", name, size);
+  if (compressible) 
+    {
+      ASSERT (size <= sizeof page * 3 / 4);
+    }
+  else 
+    {
+      ASSERT (lz_compress (page, sizeof page, packed, sizeof page * 3 / 4,
+                           work) == 0);
+    }
+  size = lz_compress (page, sizeof page, packed, sizeof packed, work);
+
+  memset (unpacked, 0xcc, sizeof unpacked);
+  ASSERT (lz_decompress (packed, size, unpacked, PGSIZE) == PGSIZE);
+  ASSERT (memcmp (unpacked, page, PGSIZE) == 0);
+  ASSERT (unpacked[PGSIZE] == 0xcc);
+
+  /* Too small an output buffer is an error. */
+  ASSERT (lz_decompress (packed, size, unpacked, PGSIZE - 1) == 0);
+}
+
+/* Checks that lz_decompress() rejects bad input. */
+static void
+check_corrupt (void)
+{
+  static const uint8_t literal_overrun[] = {31, 'a', 'b'};
+  static const uint8_t ref_before_start[] = {0, 'a', 1 << 5, 5};
+  static const uint8_t missing_offset[] = {0, 'a', 1 << 5};
+  static const uint8_t missing_length[] = {0, 'a', 7 << 5};
+  size_t size, i;
+
+  ASSERT (lz_decompress (literal_overrun, sizeof literal_overrun,
+                         unpacked, PGSIZE) == 0);
+  ASSERT (lz_decompress (ref_before_start, sizeof ref_before_start,
+                         unpacked, PGSIZE) == 0);
+  ASSERT (lz_decompress (missing_offset, sizeof missing_offset,
+                         unpacked, PGSIZE) == 0);
+  ASSERT (lz_decompress (missing_length, sizeof missing_length,
+                         unpacked, PGSIZE) == 0);
+
+  /* A truncated page never decompresses to a whole page. */
+  fill_text ();
+  size = lz_compress (page, sizeof page, packed, sizeof packed, work);
+  ASSERT (size > 0);
+  for (i = 0; i < size; i++)
+    ASSERT (lz_decompress (packed, i, unpacked, PGSIZE) < PGSIZE);
+
+  /* Random damage must not overrun the output buffer. */
+  for (i = 0; i < 1000; i++)
+    {
+      size = lz_compress (page, sizeof page, packed, sizeof packed, work);
+      packed[random_ulong () % size] = random_ulong ();
+      unpacked[PGSIZE] = 0xcc;
+      ASSERT (lz_decompress (packed, size, unpacked, PGSIZE) <= PGSIZE);
+      ASSERT (unpacked[PGSIZE] == 0xcc);
+    }
+}
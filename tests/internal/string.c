@@ -0,0 +1,220 @@
+/* Test program for the block functions in lib/string.c.
+
+   Checks memcpy(), memmove(), memset(), memcmp(), and strlen()
+   against simple byte-at-a-time versions for every combination
+   of small size and alignment, then times bulk copies and clears
+   with both.
+
+   This is not a test we will run on your submitted projects.
+   It is here for completeness.
+*/
+
+#undef NDEBUG
+#include <debug.h>
+#include <inttypes.h>
+#include <random.h>
+#include <stdio.h>
+#include <string.h>
+#include "devices/timer.h"
+#include "threads/test.h"
+
+/* Largest block checked for correctness. */
+#define MAX_SIZE 64
+
+/* Size of the buffers used for timing. */
+#define BENCH_SIZE 4096
+
+/* Number of times each timed operation is repeated. */
+#define BENCH_ROUNDS 20000
+
+static void check_copy (void);
+static void check_set (void);
+static void check_cmp (void);
+static void check_strlen (void);
+static void bench (void);
+
+/* Test the block functions. */
+void
+test (void)
+{
+  printf ("checking memcpy and memmove...\n");
+  check_copy ();
+  printf ("checking memset...\n");
+  check_set ();
+  printf ("checking memcmp...\n");
+  check_cmp ();
+  printf ("checking strlen...\n");
+  check_strlen ();
+  printf ("timing bulk operations...\n");
+  bench ();
+  printf ("done\n");
+}
+
+static unsigned char buf[MAX_SIZE * 3];
+static unsigned char ref[MAX_SIZE * 3];
+
+/* Reference versions. */
+static void
+byte_move (unsigned char *dst, const unsigned char *src, size_t size)
+{
+  if (dst < src)
+    while (size-- > 0)
+      *dst++ = *src++;
+  else
+    {
+      dst += size;
+      src += size;
+      while (size-- > 0)
+        *--dst = *--src;
+    }
+}
+
+static void
+byte_set (unsigned char *dst, int value, size_t size)
+{
+  while (size-- > 0)
+    *dst++ = value;
+}
+
+/* Fills buf and ref with the same random bytes. */
+static void
+randomize (void)
+{
+  random_bytes (buf, sizeof buf);
+  memcpy (ref, buf, sizeof buf);
+  ASSERT (memcmp (ref, buf, sizeof buf) == 0);
+}
+
+/* Verifies that buf and ref agree byte for byte. */
+static void
+verify (void)
+{
+  size_t i;
+
+  for (i = 0; i < sizeof buf; i++)
+    ASSERT (buf[i] == ref[i]);
+}
+
+/* Checks memcpy() and memmove() at every alignment and size up
+   to MAX_SIZE, including overlapping moves in both
+   directions. */
+static void
+check_copy (void)
+{
+  size_t size, dst_ofs, src_ofs;
+
+  for (size = 0; size <= MAX_SIZE; size++)
+    for (dst_ofs = 0; dst_ofs < 8; dst_ofs++)
+      for (src_ofs = 0; src_ofs < 8; src_ofs++)
+        {
+          unsigned char *lo = buf + dst_ofs;
+          unsigned char *hi = buf + MAX_SIZE + src_ofs;
+
+          randomize ();
+          memcpy (lo, hi, size);
+          byte_move (ref + dst_ofs, ref + MAX_SIZE + src_ofs, size);
+          verify ();
+
+          randomize ();
+          memmove (buf + dst_ofs + 3, buf + src_ofs, size);
+          byte_move (ref + dst_ofs + 3, ref + src_ofs, size);
+          verify ();
+
+          randomize ();
+          memmove (buf + dst_ofs, buf + src_ofs + 3, size);
+          byte_move (ref + dst_ofs, ref + src_ofs + 3, size);
+          verify ();
+        }
+}
+
+/* Checks memset() at every alignment and size up to MAX_SIZE. */
+static void
+check_set (void)
+{
+  size_t size, ofs;
+
+  for (size = 0; size <= MAX_SIZE; size++)
+    for (ofs = 0; ofs < 8; ofs++)
+      {
+        int value = random_ulong ();
+
+        randomize ();
+        memset (buf + ofs, value, size);
+        byte_set (ref + ofs, value, size);
+        verify ();
+      }
+}
+
+/* Checks that memcmp() finds a single flipped bit anywhere in a
+   block and orders the blocks correctly. */
+static void
+check_cmp (void)
+{
+  size_t size, ofs, i;
+
+  for (size = 1; size <= MAX_SIZE; size++)
+    for (ofs = 0; ofs < 8; ofs++)
+      for (i = 0; i < size; i++)
+        {
+          randomize ();
+          ASSERT (memcmp (buf + ofs, ref + ofs, size) == 0);
+          ref[ofs + i] ^= 0x80;
+          if (buf[ofs + i] > ref[ofs + i]) 
+            {
+              ASSERT (memcmp (buf + ofs, ref + ofs, size) > 0);
+            }
+          else 
+            {
+              ASSERT (memcmp (buf + ofs, ref + ofs, size) < 0);
+            }
+        }
+}
+
+/* Checks strlen() at every alignment and length up to
+   MAX_SIZE. */
+static void
+check_strlen (void)
+{
+  size_t len, ofs, i;
+
+  for (len = 0; len < MAX_SIZE; len++)
+    for (ofs = 0; ofs < 8; ofs++)
+      {
+        randomize ();
+        for (i = 0; i < len; i++)
+          if (buf[ofs + i] == '\0')
+            buf[ofs + i] = 'x';
+        buf[ofs + len] = '\0';
+        ASSERT (strlen ((char *) buf + ofs) == len);
+      }
+}
+
+/* Times bulk copies and clears with the library functions and
+   with the reference versions, and prints the results. */
+static void
+bench (void)
+{
+  static unsigned char src[BENCH_SIZE], dst[BENCH_SIZE];
+  int64_t start;
+  int i;
+
+  start = timer_ticks ();
+  for (i = 0; i < BENCH_ROUNDS; i++)
+    memcpy (dst, src, sizeof dst);
+  printf ("memcpy: %"PRId64" ticks\n", timer_elapsed (start));
+
+  start = timer_ticks ();
+  for (i = 0; i < BENCH_ROUNDS; i++)
+    byte_move (dst, src, sizeof dst);
+  printf ("byte copy: %"PRId64" ticks\n", timer_elapsed (start));
+
+  start = timer_ticks ();
+  for (i = 0; i < BENCH_ROUNDS; i++)
+    memset (dst, i, sizeof dst);
+  printf ("memset: %"PRId64" ticks\n", timer_elapsed (start));
+
+  start = timer_ticks ();
+  for (i = 0; i < BENCH_ROUNDS; i++)
+    byte_set (dst, i, sizeof dst);
+  printf ("byte set: %"PRId64" ticks\n", timer_elapsed (start));
+}
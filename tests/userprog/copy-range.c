@@ -0,0 +1,36 @@
+/* Copies "sample.txt" into a new file with copy_file_range(), in
+   two pieces, and verifies the copy and both file positions.
+   Also checks that a copy into this running, and so
+   write-protected, executable fails instead of returning 0. */
+
+#include <syscall.h>
+#include "tests/userprog/sample.inc"
+#include "tests/lib.h"
+#include "tests/main.h"
+
+void
+test_main (void) 
+{
+  int in_fd, out_fd, exe_fd;
+
+  CHECK ((in_fd = open ("sample.txt")) > 1, "open \"sample.txt\"");
+  CHECK (create ("copy", 0), "create \"copy\"");
+  CHECK ((out_fd = open ("copy")) > 1, "open \"copy\"");
+
+  CHECK (copy_file_range (in_fd, out_fd, 100) == 100, "copy 100 bytes");
+  CHECK (copy_file_range (in_fd, out_fd, 1000) == sizeof sample - 101,
+         "copy the rest");
+  CHECK (tell (in_fd) == sizeof sample - 1, "tell \"sample.txt\"");
+  CHECK (tell (out_fd) == sizeof sample - 1, "tell \"copy\"");
+  CHECK (copy_file_range (in_fd, out_fd, 1000) == 0, "copy at end of file");
+  CHECK (copy_file_range (in_fd, 1234, 1) == -1, "copy to bad fd");
+  CHECK ((exe_fd = open ("copy-range")) > 1, "open \"copy-range\"");
+  seek (in_fd, 0);
+  CHECK (copy_file_range (in_fd, exe_fd, 100) == -1,
+         "copy to running executable");
+  close (exe_fd);
+  close (in_fd);
+  close (out_fd);
+
+  check_file ("copy", sample, sizeof sample - 1);
+}
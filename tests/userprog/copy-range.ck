@@ -0,0 +1,24 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(copy-range) begin
+(copy-range) open "sample.txt"
+(copy-range) create "copy"
+(copy-range) open "copy"
+(copy-range) copy 100 bytes
+(copy-range) copy the rest
+(copy-range) tell "sample.txt"
+(copy-range) tell "copy"
+(copy-range) copy at end of file
+(copy-range) copy to bad fd
+(copy-range) open "copy-range"
+(copy-range) copy to running executable
+(copy-range) open "copy" for verification
+(copy-range) verified contents of "copy"
+(copy-range) close "copy"
+(copy-range) end
+copy-range: exit(0)
+EOF
+pass;
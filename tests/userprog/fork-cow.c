@@ -0,0 +1,29 @@
+/* Forks a child that overwrites a global array, and verifies
+   that the parent's copy of the array is unaffected. */
+
+#include <string.h>
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+static char buf[4096 * 2];
+
+void
+test_main (void) 
+{
+  pid_t pid;
+  size_t i;
+
+  memset (buf, 'p', sizeof buf);
+  pid = fork ();
+  if (pid == 0)
+    {
+      memset (buf, 'c', sizeof buf);
+      exit (buf[0] == 'c' && buf[sizeof buf - 1] == 'c' ? 81 : 1);
+    }
+  CHECK (pid > 0, "fork");
+  msg ("wait(fork()) = %d", wait (pid));
+  for (i = 0; i < sizeof buf; i++)
+    if (buf[i] != 'p')
+      fail ("parent's buf[%zu] changed to '%c'", i, buf[i]);
+}
@@ -0,0 +1,49 @@
+/* Creates a directory and two files, then lists the root
+   directory with getdents(), two entries at a time, and checks
+   that each entry turns up once with the right type and inode
+   number. */
+
+#include <string.h>
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+static const char *names[] = {"a", "b", "c"};
+
+void
+test_main (void) 
+{
+  struct dirent entries[2];
+  int found[3] = {0, 0, 0};
+  int root_fd, cnt, i, j;
+
+  CHECK (mkdir ("a"), "mkdir \"a\"");
+  CHECK (create ("b", 0), "create \"b\"");
+  CHECK (create ("c", 0), "create \"c\"");
+  CHECK ((root_fd = open ("/")) > 1, "open \"/\"");
+
+  while ((cnt = getdents (root_fd, entries, sizeof entries)) > 0)
+    for (i = 0; i < cnt; i++)
+      for (j = 0; j < 3; j++)
+        if (!strcmp (entries[i].name, names[j])) 
+          {
+            int fd = open (names[j]);
+            if (fd < 2)
+              fail ("open \"%s\" failed", names[j]);
+            if (entries[i].is_dir != (j == 0))
+              fail ("\"%s\" has the wrong type", names[j]);
+            if (entries[i].inumber != inumber (fd))
+              fail ("\"%s\" has the wrong inode number", names[j]);
+            close (fd);
+            found[j]++;
+          }
+  CHECK (cnt == 0, "getdents reached the end");
+
+  for (j = 0; j < 3; j++)
+    if (found[j] != 1)
+      fail ("\"%s\" found %d times", names[j], found[j]);
+  CHECK (getdents (root_fd, entries, sizeof entries[0] - 1) == -1,
+         "getdents with short buffer");
+  CHECK (getdents (1234, entries, sizeof entries) == -1,
+         "getdents on bad fd");
+}
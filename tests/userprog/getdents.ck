@@ -0,0 +1,17 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(getdents) begin
+(getdents) mkdir "a"
+(getdents) create "b"
+(getdents) create "c"
+(getdents) open "/"
+(getdents) getdents reached the end
+(getdents) getdents with short buffer
+(getdents) getdents on bad fd
+(getdents) end
+getdents: exit(0)
+EOF
+pass;
@@ -0,0 +1,38 @@
+/* Reads and writes "sample.txt" at explicit offsets with pread()
+   and pwrite(), and verifies that the file position is left
+   alone. */
+
+#include <string.h>
+#include <syscall.h>
+#include "tests/userprog/sample.inc"
+#include "tests/lib.h"
+#include "tests/main.h"
+
+void
+test_main (void) 
+{
+  char buf[32];
+  int fd;
+
+  CHECK ((fd = open ("sample.txt")) > 1, "open \"sample.txt\"");
+  seek (fd, 5);
+
+  CHECK (pread (fd, buf, 20, 10) == 20, "pread 20 bytes at offset 10");
+  if (memcmp (buf, sample + 10, 20))
+    fail ("pread returned wrong data");
+  CHECK (tell (fd) == 5, "tell after pread");
+
+  CHECK (pwrite (fd, "Quux", 4, 1) == 4, "pwrite 4 bytes at offset 1");
+  CHECK (tell (fd) == 5, "tell after pwrite");
+  CHECK (pread (fd, buf, 6, 0) == 6, "pread 6 bytes at offset 0");
+  if (memcmp (buf, "\"Quuxi", 6))
+    fail ("pread did not see pwrite's data");
+
+  CHECK (read (fd, buf, 4) == 4, "read 4 bytes");
+  if (memcmp (buf, sample + 5, 4))
+    fail ("read returned wrong data");
+
+  CHECK (pread (fd, buf, sizeof buf, sizeof sample - 1) == 0,
+         "pread at end of file");
+  CHECK (pread (fd, buf, 1, -1) == -1, "pread at negative offset");
+}
@@ -0,0 +1,19 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(pread-pwrite) begin
+(pread-pwrite) open "sample.txt"
+(pread-pwrite) pread 20 bytes at offset 10
+(pread-pwrite) tell after pread
+(pread-pwrite) pwrite 4 bytes at offset 1
+(pread-pwrite) tell after pwrite
+(pread-pwrite) pread 6 bytes at offset 0
+(pread-pwrite) read 4 bytes
+(pread-pwrite) pread at end of file
+(pread-pwrite) pread at negative offset
+(pread-pwrite) end
+pread-pwrite: exit(0)
+EOF
+pass;
@@ -0,0 +1,29 @@
+/* Writes a file from several buffers with writev(), then reads
+   it back into differently sized buffers with readv(). */
+
+#include <string.h>
+#include <syscall.h>
+#include "tests/lib.h"
+#include "tests/main.h"
+
+void
+test_main (void) 
+{
+  char a[5], b[16];
+  struct iovec out[3] = {{"Hello, ", 7}, {NULL, 0}, {"world\n", 6}};
+  struct iovec in[2] = {{a, sizeof a}, {b, sizeof b}};
+  int fd;
+
+  CHECK (create ("data", 0), "create \"data\"");
+  CHECK ((fd = open ("data")) > 1, "open \"data\"");
+  CHECK (writev (fd, out, 3) == 13, "writev 13 bytes");
+  CHECK (tell (fd) == 13, "tell after writev");
+
+  seek (fd, 0);
+  CHECK (readv (fd, in, 2) == 13, "readv 13 bytes");
+  if (memcmp (a, "Hello", 5) || memcmp (b, ", world\n", 8))
+    fail ("readv returned wrong data");
+
+  CHECK (writev (fd, out, -1) == -1, "writev with negative count");
+  CHECK (readv (fd, in, IOV_MAX + 1) == -1, "readv with too many buffers");
+}
@@ -0,0 +1,17 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(readv-writev) begin
+(readv-writev) create "data"
+(readv-writev) open "data"
+(readv-writev) writev 13 bytes
+(readv-writev) tell after writev
+(readv-writev) readv 13 bytes
+(readv-writev) writev with negative count
+(readv-writev) readv with too many buffers
+(readv-writev) end
+readv-writev: exit(0)
+EOF
+pass;
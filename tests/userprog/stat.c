@@ -0,0 +1,39 @@
+/* Checks stat() and fstat() on "sample.txt", on the root
+   directory, and on a file that does not exist. */
+
+#include <syscall.h>
+#include "tests/userprog/sample.inc"
+#include "tests/lib.h"
+#include "tests/main.h"
+
+void
+test_main (void) 
+{
+  struct stat st;
+  int fd;
+
+  CHECK (stat ("sample.txt", &st), "stat \"sample.txt\"");
+  if (st.size != sizeof sample - 1)
+    fail ("stat reported size %d, expected %zu", st.size, sizeof sample - 1);
+  if (st.is_dir)
+    fail ("stat reported \"sample.txt\" as a directory");
+  if (st.open_cnt != 0)
+    fail ("stat reported %d openers, expected 0", st.open_cnt);
+
+  CHECK ((fd = open ("sample.txt")) > 1, "open \"sample.txt\"");
+  CHECK (fstat (fd, &st), "fstat \"sample.txt\"");
+  if (st.size != sizeof sample - 1)
+    fail ("fstat reported size %d, expected %zu", st.size, sizeof sample - 1);
+  if (st.inumber != inumber (fd))
+    fail ("fstat reported the wrong inode number");
+  if (st.open_cnt != 1)
+    fail ("fstat reported %d openers, expected 1", st.open_cnt);
+  close (fd);
+
+  CHECK (stat ("/", &st), "stat \"/\"");
+  if (!st.is_dir)
+    fail ("stat did not report \"/\" as a directory");
+
+  CHECK (!stat ("no-such-file", &st), "stat \"no-such-file\"");
+  CHECK (!fstat (1234, &st), "fstat on bad fd");
+}
@@ -0,0 +1,16 @@
+# -*- perl -*-
+use strict;
+use warnings;
+use tests::tests;
+check_expected ([<<'EOF']);
+(stat) begin
+(stat) stat "sample.txt"
+(stat) open "sample.txt"
+(stat) fstat "sample.txt"
+(stat) stat "/"
+(stat) stat "no-such-file"
+(stat) fstat on bad fd
+(stat) end
+stat: exit(0)
+EOF
+pass;
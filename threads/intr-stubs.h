@@ -16,4 +16,7 @@ extern intr_stub_func *intr_stubs[256];
 /* Interrupt return path. */
 void intr_exit (void);
 
+/* Fast system call entry point, for SYSENTER. */
+void sysenter_entry (void);
+
 #endif /* threads/intr-stubs.h */
@@ -5,42 +5,68 @@
 #include <stdint.h>
 #include <stdio.h>
 #include <string.h>
+#include "threads/init.h"
 #include "threads/palloc.h"
 #include "threads/synch.h"
 #include "threads/vaddr.h"
 
 /* A simple implementation of malloc().
 
-   The size of each request, in bytes, is rounded up to a power
-   of 2 and assigned to the "descriptor" that manages blocks of
-   that size.  The descriptor keeps a list of free blocks.  If
+   The size of each request, in bytes, is rounded up to the
+   nearest size class and assigned to the "descriptor" that
+   manages blocks of that size.  Size classes start at 16 bytes
+   and grow in steps of about 1.25x (rounded to a multiple of 8
+   bytes) up to 4 kB, so that no more than about 20% of a block
+   is wasted.  The descriptor keeps a list of free blocks.  If
    the free list is nonempty, one of its blocks is used to
    satisfy the request.
 
-   Otherwise, a new page of memory, called an "arena", is
-   obtained from the page allocator (if none is available,
-   malloc() returns a null pointer).  The new arena is divided
-   into blocks, all of which are added to the descriptor's free
-   list.  Then we return one of the new blocks.
+   Otherwise, a new "arena" of one or more pages is obtained from
+   the page allocator (if none is available, malloc() returns a
+   null pointer).  Each descriptor uses the arena size, from 1 to
+   MAX_ARENA_PAGES pages, that wastes the least space after
+   packing in as many blocks as fit, which lets blocks of 1 to
+   4 kB share arenas instead of each getting pages of their own.
+   The new arena is divided into blocks, all of which are added
+   to the descriptor's free list.  Then we return one of the new
+   blocks.
 
    When we free a block, we add it to its descriptor's free list.
    But if the arena that the block was in now has no in-use
    blocks, we remove all of the arena's blocks from the free list
    and give the arena back to the page allocator.
 
-   We can't handle blocks bigger than 2 kB using this scheme,
-   because they're too big to fit in a single page with a
-   descriptor.  We handle those by allocating contiguous pages
-   with the page allocator and sticking the allocation size at
-   the beginning of the allocated block's arena header. */
+   A block in a multi-page arena may start in any of its pages,
+   so we can't find the arena header just by rounding the block's
+   address down to a page boundary.  Instead, page_idx[] records,
+   for each page of physical memory, how many pages into its
+   arena it lies.
+
+   We handle blocks bigger than 4 kB by allocating contiguous
+   pages with the page allocator and sticking the allocation
+   size at the beginning of the allocated block's arena header.
+
+   Each descriptor counts the bytes requested from it and the
+   bytes it handed out to satisfy those requests, so that the
+   cost of rounding can be seen, along with how many blocks and
+   arenas are in use.  See malloc_get_stats() and
+   malloc_print_stats(). */
+
+/* Largest size class. */
+#define MAX_BLOCK_SIZE PGSIZE
+
+/* Most pages in an arena. */
+#define MAX_ARENA_PAGES 4
 
 /* Descriptor. */
 struct desc
   {
     size_t block_size;          /* Size of each element in bytes. */
     size_t blocks_per_arena;    /* Number of blocks in an arena. */
+    size_t arena_pages;         /* Number of pages in an arena. */
     struct list free_list;      /* List of free blocks. */
     struct lock lock;           /* Lock. */
+    struct malloc_stats stats;  /* Statistics. */
   };
 
 /* Magic number for detecting arena corruption. */
@@ -61,11 +87,24 @@ struct block
   };
 
 /* Our set of descriptors. */
-static struct desc descs[10];   /* Descriptors. */
+static struct desc descs[32];   /* Descriptors. */
 static size_t desc_cnt;         /* Number of descriptors. */
 
+/* Statistics for big blocks.  Its arena_cnt counts pages. */
+static struct malloc_stats big_stats;
+static struct lock big_lock;
+
+/* For each page of physical memory, the number of pages between
+   it and the start of the arena that contains it. */
+static uint8_t *page_idx;
+
 static struct arena *block_to_arena (struct block *);
 static struct block *arena_to_block (struct arena *, size_t idx);
+static void set_page_idx (struct arena *, size_t page_cnt, bool in_use);
+static void count_alloc (struct malloc_stats *, size_t requested,
+                         size_t consumed);
+static void count_failure (struct malloc_stats *, struct lock *);
+static void print_class_stats (const struct malloc_stats *);
 
 /* Initializes the malloc() descriptors. */
 void
@@ -73,14 +112,42 @@ malloc_init (void)
 {
   size_t block_size;
 
-  for (block_size = 16; block_size < PGSIZE / 2; block_size *= 2)
+  page_idx = palloc_get_multiple (PAL_ASSERT | PAL_ZERO,
+                                  DIV_ROUND_UP (init_ram_pages, PGSIZE));
+  lock_init (&big_lock);
+
+  for (block_size = 16; ; block_size = ROUND_UP (block_size * 5 / 4, 8))
     {
       struct desc *d = &descs[desc_cnt++];
+      size_t best_waste = SIZE_MAX;
+      size_t pages;
+
       ASSERT (desc_cnt <= sizeof descs / sizeof *descs);
-      d->block_size = block_size;
-      d->blocks_per_arena = (PGSIZE - sizeof (struct arena)) / block_size;
+      if (block_size > MAX_BLOCK_SIZE)
+        block_size = MAX_BLOCK_SIZE;
+
+      /* Pick the arena size that wastes the smallest fraction of
+         its pages, preferring smaller arenas on ties. */
+      for (pages = 1; pages <= MAX_ARENA_PAGES; pages++) 
+        {
+          size_t usable = pages * PGSIZE - sizeof (struct arena);
+          size_t waste = usable % block_size + sizeof (struct arena);
+          if (usable / block_size > 0
+              && waste * MAX_ARENA_PAGES / pages < best_waste) 
+            {
+              best_waste = waste * MAX_ARENA_PAGES / pages;
+              d->arena_pages = pages;
+            }
+        }
+
+      d->block_size = d->stats.block_size = block_size;
+      d->blocks_per_arena = ((d->arena_pages * PGSIZE - sizeof (struct arena))
+                             / block_size);
       list_init (&d->free_list);
       lock_init (&d->lock);
+
+      if (block_size == MAX_BLOCK_SIZE)
+        break;
     }
 }
 
@@ -109,13 +176,21 @@ malloc (size_t size)
       size_t page_cnt = DIV_ROUND_UP (size + sizeof *a, PGSIZE);
       a = palloc_get_multiple (0, page_cnt);
       if (a == NULL)
-        return NULL;
+        {
+          count_failure (&big_stats, &big_lock);
+          return NULL;
+        }
 
       /* Initialize the arena to indicate a big block of PAGE_CNT
          pages, and return it. */
       a->magic = ARENA_MAGIC;
       a->desc = NULL;
       a->free_cnt = page_cnt;
+
+      lock_acquire (&big_lock);
+      count_alloc (&big_stats, size, page_cnt * PGSIZE);
+      big_stats.arena_cnt += page_cnt;
+      lock_release (&big_lock);
       return a + 1;
     }
 
@@ -126,18 +201,23 @@ malloc (size_t size)
     {
       size_t i;
 
-      /* Allocate a page. */
-      a = palloc_get_page (0);
+      /* Allocate pages.  Drop the lock meanwhile, because the
+         page allocator may call shrinkers that free memory. */
+      lock_release (&d->lock);
+      a = palloc_get_multiple (0, d->arena_pages);
       if (a == NULL) 
         {
-          lock_release (&d->lock);
+          count_failure (&d->stats, &d->lock);
           return NULL; 
         }
+      lock_acquire (&d->lock);
+      d->stats.arena_cnt++;
 
       /* Initialize arena and add its blocks to the free list. */
       a->magic = ARENA_MAGIC;
       a->desc = d;
       a->free_cnt = d->blocks_per_arena;
+      set_page_idx (a, d->arena_pages, true);
       for (i = 0; i < d->blocks_per_arena; i++) 
         {
           struct block *b = arena_to_block (a, i);
@@ -149,6 +229,7 @@ malloc (size_t size)
   b = list_entry (list_pop_front (&d->free_list), struct block, free_elem);
   a = block_to_arena (b);
   a->free_cnt--;
+  count_alloc (&d->stats, size, d->block_size);
   lock_release (&d->lock);
   return b;
 }
@@ -249,33 +330,144 @@ free (void *p)
                   struct block *b = arena_to_block (a, i);
                   list_remove (&b->free_elem);
                 }
-              palloc_free_page (a);
+              set_page_idx (a, d->arena_pages, false);
+              palloc_free_multiple (a, d->arena_pages);
+              d->stats.arena_cnt--;
             }
 
+          d->stats.live_cnt--;
           lock_release (&d->lock);
         }
       else
         {
           /* It's a big block.  Free its pages. */
+          lock_acquire (&big_lock);
+          big_stats.live_cnt--;
+          big_stats.arena_cnt -= a->free_cnt;
+          lock_release (&big_lock);
           palloc_free_multiple (a, a->free_cnt);
           return;
         }
     }
 }
 
+/* Copies the statistics for up to CNT size classes into STATS,
+   smallest first, followed by those for big blocks (with a
+   block_size of 0).  Returns the total number of entries
+   available, which may be more than CNT. */
+size_t
+malloc_get_stats (struct malloc_stats *stats, size_t cnt) 
+{
+  size_t i;
+
+  for (i = 0; i < desc_cnt && i < cnt; i++) 
+    {
+      lock_acquire (&descs[i].lock);
+      stats[i] = descs[i].stats;
+      lock_release (&descs[i].lock);
+    }
+  if (desc_cnt < cnt) 
+    {
+      lock_acquire (&big_lock);
+      stats[desc_cnt] = big_stats;
+      lock_release (&big_lock);
+    }
+  return desc_cnt + 1;
+}
+
+/* Prints allocation statistics. */
+void
+malloc_print_stats (void) 
+{
+  struct malloc_stats total = big_stats;
+  struct desc *d;
+
+  for (d = descs; d < descs + desc_cnt; d++) 
+    {
+      total.alloc_cnt += d->stats.alloc_cnt;
+      total.requested += d->stats.requested;
+      total.consumed += d->stats.consumed;
+      total.live_cnt += d->stats.live_cnt;
+      total.fail_cnt += d->stats.fail_cnt;
+    }
+  printf ("Malloc: %llu allocations, %llu bytes requested, "
+          "%llu bytes consumed, %zu blocks in use, %zu failures\n",
+          total.alloc_cnt, total.requested, total.consumed,
+          total.live_cnt, total.fail_cnt);
+
+  for (d = descs; d < descs + desc_cnt; d++)
+    if (d->stats.alloc_cnt > 0)
+      print_class_stats (&d->stats);
+  if (big_stats.alloc_cnt > 0)
+    print_class_stats (&big_stats);
+}
+
+/* Prints the statistics in S for one size class. */
+static void
+print_class_stats (const struct malloc_stats *s) 
+{
+  if (s->block_size != 0)
+    printf ("  %4zu-byte blocks: ", s->block_size);
+  else
+    printf ("  big blocks: ");
+  printf ("%llu allocations, %llu bytes requested, %llu bytes consumed, "
+          "%zu in use (peak %zu), %zu %s, %zu failures\n",
+          s->alloc_cnt, s->requested, s->consumed, s->live_cnt,
+          s->peak_cnt, s->arena_cnt, s->block_size != 0 ? "arenas" : "pages",
+          s->fail_cnt);
+}
+
+/* Adds an allocation of REQUESTED bytes that used CONSUMED bytes
+   to STATS. */
+static void
+count_alloc (struct malloc_stats *stats, size_t requested, size_t consumed) 
+{
+  stats->alloc_cnt++;
+  stats->requested += requested;
+  stats->consumed += consumed;
+  if (++stats->live_cnt > stats->peak_cnt)
+    stats->peak_cnt = stats->live_cnt;
+}
+
+/* Adds a failed allocation to STATS, which is protected by
+   LOCK. */
+static void
+count_failure (struct malloc_stats *stats, struct lock *lock) 
+{
+  lock_acquire (lock);
+  stats->fail_cnt++;
+  lock_release (lock);
+}
+
+/* Records in page_idx[] that the PAGE_CNT pages of arena A are
+   in use, if IN_USE is true, or free, if it is false. */
+static void
+set_page_idx (struct arena *a, size_t page_cnt, bool in_use) 
+{
+  uint8_t *idx = page_idx + (vtop (a) >> PGBITS);
+  size_t i;
+
+  for (i = 1; i < page_cnt; i++)
+    idx[i] = in_use ? i : 0;
+}
+
 /* Returns the arena that block B is inside. */
 static struct arena *
 block_to_arena (struct block *b)
 {
   struct arena *a = pg_round_down (b);
 
+  /* Step back to the start of a multi-page arena. */
+  a = (struct arena *) ((uint8_t *) a
+                        - page_idx[vtop (a) >> PGBITS] * PGSIZE);
+
   /* Check that the arena is valid. */
   ASSERT (a != NULL);
   ASSERT (a->magic == ARENA_MAGIC);
 
   /* Check that the block is properly aligned for the arena. */
   ASSERT (a->desc == NULL
-          || (pg_ofs (b) - sizeof *a) % a->desc->block_size == 0);
+          || ((uint8_t *) b - (uint8_t *) (a + 1)) % a->desc->block_size == 0);
   ASSERT (a->desc != NULL || pg_ofs (b) == sizeof *a);
 
   return a;
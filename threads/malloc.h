@@ -4,10 +4,25 @@
 #include <debug.h>
 #include <stddef.h>
 
+/* Usage statistics for one malloc() size class. */
+struct malloc_stats
+  {
+    size_t block_size;                  /* Block size, 0 for big blocks. */
+    unsigned long long alloc_cnt;       /* Number of allocations. */
+    unsigned long long requested;       /* Bytes requested. */
+    unsigned long long consumed;        /* Bytes handed out. */
+    size_t live_cnt;                    /* Blocks now in use. */
+    size_t peak_cnt;                    /* Most blocks ever in use. */
+    size_t arena_cnt;                   /* Arenas now held. */
+    size_t fail_cnt;                    /* Failed allocations. */
+  };
+
 void malloc_init (void);
 void *malloc (size_t) __attribute__ ((malloc));
 void *calloc (size_t, size_t) __attribute__ ((malloc));
 void *realloc (void *, size_t);
 void free (void *);
+size_t malloc_get_stats (struct malloc_stats *, size_t cnt);
+void malloc_print_stats (void);
 
 #endif /* threads/malloc.h */
@@ -2,12 +2,15 @@
 #include <bitmap.h>
 #include <debug.h>
 #include <inttypes.h>
+#include <list.h>
 #include <round.h>
 #include <stddef.h>
 #include <stdint.h>
 #include <stdio.h>
 #include <string.h>
+#include "threads/interrupt.h"
 #include "threads/loader.h"
+#include "threads/shrinker.h"
 #include "threads/synch.h"
 #include "threads/vaddr.h"
 
@@ -22,23 +25,113 @@
    even if user processes are swapping like mad.
 
    By default, half of system RAM is given to the kernel pool and
-   half to the user pool.  That should be huge overkill for the
-   kernel pool, but that's just fine for demonstration purposes. */
+   half to the user pool.  That split is only a starting point:
+   memory is divided into "chunks" of CHUNK_PAGES pages, each
+   owned by one pool, and when a pool runs out it borrows a
+   completely free chunk from the other pool.  A pool never lends
+   memory that would leave it with fewer than its reserve of free
+   pages, which guarantees the kernel a quarter of its initial
+   share.  A borrowed chunk goes back to its home pool once it is
+   free again and the borrower has plenty of free memory of its
+   own.  The user pool never grows beyond the -ul limit.
+
+   Within a pool, pages are managed by a binary buddy allocator.
+   Free memory is kept as blocks of 2**ORDER pages, aligned on a
+   multiple of their size, on one free list per order.  A request
+   is satisfied by splitting the smallest large-enough block, and
+   a freed block is merged with its "buddy" (the other half of
+   the block of the next higher order) for as long as the buddy
+   is also free and, for blocks of a chunk or larger, belongs to
+   the same pool.  Both take O(log n) time in the pool size.  A
+   request that is not a power of 2 in size is rounded up and the
+   unused tail is freed again right away, so exactly PAGE_CNT
+   pages are in use.  The used_map bitmap is maintained only to
+   catch double frees and the like in debug builds.
+
+   Each pool also holds a small stock of single pages that the
+   idle thread has already cleared (see palloc_prezero()), so that
+   most PAL_ZERO requests need not clear a page while the caller
+   waits.  These pages count as allocated; they are handed back to
+   the buddy allocator if it runs dry.
+
+   If a request still cannot be satisfied, the registered
+   shrinkers (see shrinker.c) are asked to release cached memory
+   before we give up. */
+
+/* Largest block order.  2**MAX_ORDER pages is 4 GB. */
+#define MAX_ORDER 20
+
+/* Unit in which pools lend memory to each other: 256 kB. */
+#define CHUNK_ORDER 6
+#define CHUNK_PAGES (1 << CHUNK_ORDER)
+
+/* page_order[] value for a page that is not the first page of a
+   free block. */
+#define NOT_FREE 0xff
+
+/* A free block, stored in its own first page. */
+struct free_block
+  {
+    struct list_elem elem;              /* Element in free_lists[]. */
+  };
 
 /* A memory pool. */
 struct pool
   {
     struct lock lock;                   /* Mutual exclusion. */
-    struct bitmap *used_map;            /* Bitmap of free pages. */
-    uint8_t *base;                      /* Base of pool. */
+    size_t page_cnt;                    /* Pages in chunks we own. */
+    size_t free_cnt;                    /* Pages on free_lists. */
+    size_t reserve;                     /* Free pages we never lend. */
+    size_t max_cnt;                     /* Limit on page_cnt. */
+    size_t borrowed_cnt;                /* Chunks borrowed from the other pool. */
+    const char *name;                   /* Name, for statistics. */
+    struct list free_lists[MAX_ORDER + 1]; /* Free blocks by order. */
+
+    /* Pre-zeroed pages.  Protected by disabling interrupts,
+       because the idle thread must never block on the lock. */
+    struct list zeroed;                 /* Zeroed pages. */
+    size_t zeroed_cnt;                  /* Number of zeroed pages. */
+    size_t zeroed_max;                  /* Maximum zeroed_cnt. */
+
+    /* Statistics.  Protected by disabling interrupts. */
+    size_t used_cnt;                    /* Pages handed out. */
+    size_t peak_cnt;                    /* Maximum used_cnt. */
+    size_t fail_cnt;                    /* Failed requests. */
   };
 
+/* Most pages to keep pre-zeroed in a pool. */
+#define ZEROED_MAX 64
+
 /* Two pools: one for kernel data, one for user pages. */
 static struct pool kernel_pool, user_pool;
 
-static void init_pool (struct pool *, void *base, size_t page_cnt,
-                       const char *name);
+/* Memory shared by the pools.  A page's entries in used_map and
+   page_order, and its chunk's entry in chunk_owner, are
+   protected by the lock of the pool that owns the chunk. */
+static uint8_t *base;                   /* First page. */
+static size_t total_pages;              /* Number of pages. */
+static struct bitmap *used_map;         /* Pages in use. */
+static uint8_t *page_order;             /* Order of each free block. */
+static struct pool **chunk_owner;       /* Pool that owns each chunk. */
+static struct pool **chunk_home;        /* Pool each chunk started in. */
+
+static void init_pool (struct pool *, size_t page_idx, size_t page_cnt,
+                       size_t reserve, size_t max_cnt, const char *name);
 static bool page_from_pool (const struct pool *, void *page);
+static size_t try_alloc (struct pool *, size_t page_cnt);
+static size_t alloc_pages (struct pool *, size_t page_cnt);
+static void free_pages (struct pool *, size_t page_idx, size_t page_cnt);
+static size_t buddy_alloc (struct pool *, size_t page_cnt);
+static void buddy_free (struct pool *, size_t page_idx, size_t page_cnt);
+static bool borrow_chunk (struct pool *);
+static void return_chunks (struct pool *);
+static size_t take_chunk (struct pool *, bool foreign);
+static void give_chunk (struct pool *, size_t page_idx);
+static void *take_zeroed (struct pool *);
+static bool drain_zeroed (struct pool *);
+static bool prezero_pool (struct pool *);
+static void zero_pages (void *, size_t page_cnt);
+static void count_pages (struct pool *, size_t page_cnt, bool alloc);
 
 /* Initializes the page allocator.  At most USER_PAGE_LIMIT
    pages are put into the user pool. */
@@ -49,16 +142,48 @@ palloc_init (size_t user_page_limit)
   uint8_t *free_start = ptov (1024 * 1024);
   uint8_t *free_end = ptov (init_ram_pages * PGSIZE);
   size_t free_pages = (free_end - free_start) / PGSIZE;
-  size_t user_pages = free_pages / 2;
-  size_t kernel_pages;
-  if (user_pages > user_page_limit)
-    user_pages = user_page_limit;
-  kernel_pages = free_pages - user_pages;
+  size_t chunk_cnt = DIV_ROUND_UP (free_pages, CHUNK_PAGES);
+  size_t map_size = chunk_cnt * sizeof *chunk_owner;
+  size_t bm_size = bitmap_buf_size (free_pages);
+  size_t meta_pages = DIV_ROUND_UP (2 * map_size + bm_size + free_pages,
+                                    PGSIZE);
+  size_t user_pages, kernel_pages;
+  uint8_t *meta = free_start;
+
+  /* We'll put the shared tables at the start of free memory.
+     Subtract the space they need. */
+  if (meta_pages > free_pages)
+    PANIC ("Not enough memory for page allocator tables.");
+  free_pages -= meta_pages;
+
+  chunk_owner = (struct pool **) meta;
+  chunk_home = (struct pool **) (meta + map_size);
+  memset (meta, 0, 2 * map_size);
+  used_map = bitmap_create_in_buf (free_pages, meta + 2 * map_size, bm_size);
+  page_order = meta + 2 * map_size + bm_size;
+  memset (page_order, NOT_FREE, free_pages);
+  base = free_start + meta_pages * PGSIZE;
+  total_pages = free_pages;
+
+  /* Give half of memory to kernel, half to user, with the
+     boundary on a chunk boundary.  If that would exceed the user
+     page limit, the kernel pool still ends on a chunk boundary,
+     but the user pool gets only USER_PAGE_LIMIT pages and the
+     fewer than CHUNK_PAGES pages after them go unused. */
+  kernel_pages = ROUND_UP (free_pages - free_pages / 2, CHUNK_PAGES);
+  if (kernel_pages > free_pages)
+    kernel_pages = free_pages;
+  user_pages = free_pages - kernel_pages;
+  if (user_pages > user_page_limit) 
+    {
+      kernel_pages = ROUND_DOWN (free_pages - user_page_limit, CHUNK_PAGES);
+      user_pages = user_page_limit;
+    }
 
-  /* Give half of memory to kernel, half to user. */
-  init_pool (&kernel_pool, free_start, kernel_pages, "kernel pool");
-  init_pool (&user_pool, free_start + kernel_pages * PGSIZE,
-             user_pages, "user pool");
+  init_pool (&kernel_pool, 0, kernel_pages, kernel_pages / 4, SIZE_MAX,
+             "kernel pool");
+  init_pool (&user_pool, kernel_pages, user_pages, user_pages / 8,
+             user_page_limit, "user pool");
 }
 
 /* Obtains and returns a group of PAGE_CNT contiguous free pages.
@@ -77,22 +202,38 @@ palloc_get_multiple (enum palloc_flags flags, size_t page_cnt)
   if (page_cnt == 0)
     return NULL;
 
-  lock_acquire (&pool->lock);
-  page_idx = bitmap_scan_and_flip (pool->used_map, 0, page_cnt, false);
-  lock_release (&pool->lock);
+  if ((flags & PAL_ZERO) && page_cnt == 1) 
+    {
+      pages = take_zeroed (pool);
+      if (pages != NULL) 
+        {
+          count_pages (pool, 1, true);
+          return pages;
+        }
+    }
+
+  /* If memory is short, ask caches to give some back and try
+     again. */
+  page_idx = try_alloc (pool, page_cnt);
+  while (page_idx == BITMAP_ERROR && shrink_caches (page_cnt) > 0)
+    page_idx = try_alloc (pool, page_cnt);
 
   if (page_idx != BITMAP_ERROR)
-    pages = pool->base + PGSIZE * page_idx;
+    pages = base + PGSIZE * page_idx;
   else
     pages = NULL;
 
   if (pages != NULL) 
     {
+      count_pages (pool, page_cnt, true);
       if (flags & PAL_ZERO)
-        memset (pages, 0, PGSIZE * page_cnt);
+        zero_pages (pages, page_cnt);
     }
   else 
     {
+      enum intr_level old_level = intr_disable ();
+      pool->fail_cnt++;
+      intr_set_level (old_level);
       if (flags & PAL_ASSERT)
         PANIC ("palloc_get: out of pages");
     }
@@ -131,14 +272,20 @@ palloc_free_multiple (void *pages, size_t page_cnt)
   else
     NOT_REACHED ();
 
-  page_idx = pg_no (pages) - pg_no (pool->base);
+  page_idx = pg_no (pages) - pg_no (base);
 
 #ifndef NDEBUG
   memset (pages, 0xcc, PGSIZE * page_cnt);
 #endif
 
-  ASSERT (bitmap_all (pool->used_map, page_idx, page_cnt));
-  bitmap_set_multiple (pool->used_map, page_idx, page_cnt, false);
+  lock_acquire (&pool->lock);
+  free_pages (pool, page_idx, page_cnt);
+  lock_release (&pool->lock);
+  count_pages (pool, page_cnt, false);
+
+  if (pool->borrowed_cnt > 0
+      && pool->free_cnt >= pool->reserve + 2 * CHUNK_PAGES)
+    return_chunks (pool);
 }
 
 /* Frees the page at PAGE. */
@@ -148,25 +295,113 @@ palloc_free_page (void *page)
   palloc_free_multiple (page, 1);
 }
 
-/* Initializes pool P as starting at START and ending at END,
-   naming it NAME for debugging purposes. */
+/* Stores statistics for the user pool into *STATS if FLAGS
+   includes PAL_USER, otherwise for the kernel pool. */
+void
+palloc_get_stats (enum palloc_flags flags, struct palloc_stats *stats) 
+{
+  struct pool *pool = flags & PAL_USER ? &user_pool : &kernel_pool;
+  enum intr_level old_level;
+
+  lock_acquire (&pool->lock);
+  old_level = intr_disable ();
+  stats->page_cnt = pool->page_cnt;
+  stats->free_cnt = pool->free_cnt;
+  stats->zeroed_cnt = pool->zeroed_cnt;
+  stats->borrowed_cnt = pool->borrowed_cnt * CHUNK_PAGES;
+  stats->used_cnt = pool->used_cnt;
+  stats->peak_cnt = pool->peak_cnt;
+  stats->fail_cnt = pool->fail_cnt;
+  intr_set_level (old_level);
+  lock_release (&pool->lock);
+}
+
+/* Prints page allocator statistics. */
+void
+palloc_print_stats (void) 
+{
+  struct pool *pools[] = { &kernel_pool, &user_pool };
+  size_t i;
+
+  for (i = 0; i < sizeof pools / sizeof *pools; i++) 
+    {
+      struct pool *p = pools[i];
+      printf ("Palloc: %s: %zu of %zu pages in use (peak %zu), "
+              "%zu borrowed, %zu failures\n",
+              p->name, p->used_cnt, p->page_cnt, p->peak_cnt,
+              p->borrowed_cnt * CHUNK_PAGES, p->fail_cnt);
+    }
+}
+
+/* Clears one free page ahead of time for a later PAL_ZERO
+   request.  Returns true if successful, false if there is
+   nothing to do right now.  Called by the idle thread, so it
+   never blocks. */
+bool
+palloc_prezero (void) 
+{
+  return prezero_pool (&kernel_pool) || prezero_pool (&user_pool);
+}
+
+/* Tries to allocate PAGE_CNT contiguous pages from POOL, first
+   from its own memory, then from its pre-zeroed pages, then by
+   borrowing from the other pool.  Returns the index of the first
+   page, or BITMAP_ERROR on failure. */
+static size_t
+try_alloc (struct pool *pool, size_t page_cnt) 
+{
+  size_t page_idx;
+
+  lock_acquire (&pool->lock);
+  page_idx = alloc_pages (pool, page_cnt);
+  if (page_idx == BITMAP_ERROR && drain_zeroed (pool))
+    page_idx = alloc_pages (pool, page_cnt);
+  lock_release (&pool->lock);
+
+  while (page_idx == BITMAP_ERROR && page_cnt <= CHUNK_PAGES
+         && borrow_chunk (pool)) 
+    {
+      lock_acquire (&pool->lock);
+      page_idx = alloc_pages (pool, page_cnt);
+      lock_release (&pool->lock);
+    }
+  return page_idx;
+}
+
+/* Initializes pool P as owning the PAGE_CNT pages starting at
+   PAGE_IDX, naming it NAME for debugging purposes.  P will not
+   lend out memory that would leave it with fewer than RESERVE
+   free pages, nor grow beyond MAX_CNT pages. */
 static void
-init_pool (struct pool *p, void *base, size_t page_cnt, const char *name) 
+init_pool (struct pool *p, size_t page_idx, size_t page_cnt,
+           size_t reserve, size_t max_cnt, const char *name) 
 {
-  /* We'll put the pool's used_map at its base.
-     Calculate the space needed for the bitmap
-     and subtract it from the pool's size. */
-  size_t bm_pages = DIV_ROUND_UP (bitmap_buf_size (page_cnt), PGSIZE);
-  if (bm_pages > page_cnt)
-    PANIC ("Not enough memory in %s for bitmap.", name);
-  page_cnt -= bm_pages;
+  size_t chunk;
+  int order;
 
   printf ("%zu pages available in %s.\n", page_cnt, name);
 
   /* Initialize the pool. */
   lock_init (&p->lock);
-  p->used_map = bitmap_create_in_buf (page_cnt, base, bm_pages * PGSIZE);
-  p->base = base + bm_pages * PGSIZE;
+  p->page_cnt = page_cnt;
+  p->free_cnt = 0;
+  p->reserve = reserve;
+  p->max_cnt = max_cnt;
+  p->borrowed_cnt = 0;
+  p->name = name;
+  p->used_cnt = p->peak_cnt = p->fail_cnt = 0;
+  for (order = 0; order <= MAX_ORDER; order++)
+    list_init (&p->free_lists[order]);
+  list_init (&p->zeroed);
+  p->zeroed_cnt = 0;
+  p->zeroed_max = page_cnt / 16 < ZEROED_MAX ? page_cnt / 16 : ZEROED_MAX;
+
+  /* Take ownership of our chunks and put all of their pages on
+     the free lists. */
+  for (chunk = page_idx / CHUNK_PAGES;
+       chunk < DIV_ROUND_UP (page_idx + page_cnt, CHUNK_PAGES); chunk++)
+    chunk_owner[chunk] = chunk_home[chunk] = p;
+  buddy_free (p, page_idx, page_cnt);
 }
 
 /* Returns true if PAGE was allocated from POOL,
@@ -175,8 +410,345 @@ static bool
 page_from_pool (const struct pool *pool, void *page) 
 {
   size_t page_no = pg_no (page);
-  size_t start_page = pg_no (pool->base);
-  size_t end_page = start_page + bitmap_size (pool->used_map);
+  size_t start_page = pg_no (base);
+  size_t end_page = start_page + total_pages;
+
+  return (page_no >= start_page && page_no < end_page
+          && chunk_owner[(page_no - start_page) / CHUNK_PAGES] == pool);
+}
+
+/* Allocates PAGE_CNT contiguous pages from POOL and returns the
+   index of the first, or BITMAP_ERROR if there is no room.  The
+   caller must hold POOL's lock. */
+static size_t
+alloc_pages (struct pool *pool, size_t page_cnt) 
+{
+  size_t page_idx = buddy_alloc (pool, page_cnt);
+#ifndef NDEBUG
+  if (page_idx != BITMAP_ERROR) 
+    {
+      ASSERT (bitmap_none (used_map, page_idx, page_cnt));
+      bitmap_set_multiple (used_map, page_idx, page_cnt, true);
+    }
+#endif
+  return page_idx;
+}
+
+/* Frees the PAGE_CNT pages starting at PAGE_IDX in POOL.  The
+   caller must hold POOL's lock. */
+static void
+free_pages (struct pool *pool, size_t page_idx, size_t page_cnt) 
+{
+#ifndef NDEBUG
+  ASSERT (bitmap_all (used_map, page_idx, page_cnt));
+  bitmap_set_multiple (used_map, page_idx, page_cnt, false);
+#endif
+  buddy_free (pool, page_idx, page_cnt);
+}
+
+/* Removes and returns a pre-zeroed page from POOL, or a null
+   pointer if there is none. */
+static void *
+take_zeroed (struct pool *pool) 
+{
+  struct free_block *b = NULL;
+  enum intr_level old_level;
+
+  old_level = intr_disable ();
+  if (!list_empty (&pool->zeroed)) 
+    {
+      b = list_entry (list_pop_front (&pool->zeroed), struct free_block, elem);
+      pool->zeroed_cnt--;
+    }
+  intr_set_level (old_level);
+
+  /* The list element was the only thing stored in the page. */
+  if (b != NULL)
+    memset (b, 0, sizeof *b);
+  return b;
+}
+
+/* Returns all of POOL's pre-zeroed pages to its free lists.
+   Returns true if there were any.  The caller must hold POOL's
+   lock. */
+static bool
+drain_zeroed (struct pool *pool) 
+{
+  bool any = false;
+
+  for (;;) 
+    {
+      enum intr_level old_level = intr_disable ();
+      struct list_elem *e = NULL;
+      if (!list_empty (&pool->zeroed)) 
+        {
+          e = list_pop_front (&pool->zeroed);
+          pool->zeroed_cnt--;
+        }
+      intr_set_level (old_level);
+      if (e == NULL)
+        return any;
+
+      free_pages (pool, pg_no (e) - pg_no (base), 1);
+      any = true;
+    }
+}
+
+/* Zeroes one more free page in POOL, if POOL is short of them.
+   Returns true if successful. */
+static bool
+prezero_pool (struct pool *pool) 
+{
+  enum intr_level old_level;
+  size_t page_idx = BITMAP_ERROR;
+  struct free_block *b;
+
+  if (pool->zeroed_cnt >= pool->zeroed_max)
+    return false;
+
+  /* The idle thread may not sleep on the lock, and must not be
+     preempted while holding it, or it could keep another thread
+     waiting for as long as there is other work to do. */
+  old_level = intr_disable ();
+  if (lock_try_acquire (&pool->lock)) 
+    {
+      page_idx = alloc_pages (pool, 1);
+      lock_release (&pool->lock);
+    }
+  intr_set_level (old_level);
+  if (page_idx == BITMAP_ERROR)
+    return false;
+
+  b = (struct free_block *) (base + PGSIZE * page_idx);
+  zero_pages (b, 1);
+
+  old_level = intr_disable ();
+  list_push_front (&pool->zeroed, &b->elem);
+  pool->zeroed_cnt++;
+  intr_set_level (old_level);
+  return true;
+}
+
+/* Adds PAGE_CNT pages to POOL's count of pages in use if ALLOC
+   is true, otherwise subtracts them. */
+static void
+count_pages (struct pool *pool, size_t page_cnt, bool alloc) 
+{
+  enum intr_level old_level = intr_disable ();
+  if (alloc) 
+    {
+      pool->used_cnt += page_cnt;
+      if (pool->used_cnt > pool->peak_cnt)
+        pool->peak_cnt = pool->used_cnt;
+    }
+  else
+    pool->used_cnt -= page_cnt;
+  intr_set_level (old_level);
+}
+
+/* Fills the PAGE_CNT pages at PAGES with zeros, a word at a
+   time. */
+static void
+zero_pages (void *pages, size_t page_cnt) 
+{
+  size_t cnt = PGSIZE / sizeof (uint32_t) * page_cnt;
+  asm volatile ("cld; rep stosl"
+                : "+D" (pages), "+c" (cnt)
+                : "a" (0)
+                : "memory", "cc");
+}
+
+/* Moves a completely free chunk from the other pool into POOL,
+   if the other pool can spare one.  Returns true if successful,
+   false otherwise. */
+static bool
+borrow_chunk (struct pool *pool) 
+{
+  struct pool *lender = pool == &kernel_pool ? &user_pool : &kernel_pool;
+  size_t page_idx = BITMAP_ERROR;
+
+  if (pool->page_cnt + CHUNK_PAGES > pool->max_cnt)
+    return false;
+
+  lock_acquire (&lender->lock);
+  if (lender->free_cnt >= lender->reserve + CHUNK_PAGES)
+    page_idx = take_chunk (lender, false);
+  lock_release (&lender->lock);
+  if (page_idx == BITMAP_ERROR)
+    return false;
+
+  give_chunk (pool, page_idx);
+  return true;
+}
+
+/* Sends free chunks that POOL borrowed back to their home pool,
+   for as long as POOL has plenty of free pages. */
+static void
+return_chunks (struct pool *pool) 
+{
+  for (;;) 
+    {
+      size_t page_idx = BITMAP_ERROR;
+
+      lock_acquire (&pool->lock);
+      if (pool->borrowed_cnt > 0
+          && pool->free_cnt >= pool->reserve + 2 * CHUNK_PAGES)
+        page_idx = take_chunk (pool, true);
+      lock_release (&pool->lock);
+      if (page_idx == BITMAP_ERROR)
+        return;
+
+      give_chunk (chunk_home[page_idx / CHUNK_PAGES], page_idx);
+    }
+}
+
+/* Removes a completely free chunk from POOL's free lists, gives
+   up POOL's ownership of it, and returns the index of its first
+   page.  If FOREIGN is true, only a chunk whose home is another
+   pool will do.  Returns BITMAP_ERROR if there is no suitable
+   chunk.  The caller must hold POOL's lock. */
+static size_t
+take_chunk (struct pool *pool, bool foreign) 
+{
+  int order;
+
+  for (order = CHUNK_ORDER; order <= MAX_ORDER; order++) 
+    {
+      struct list *list = &pool->free_lists[order];
+      struct list_elem *e;
+
+      for (e = list_begin (list); e != list_end (list); e = list_next (e)) 
+        {
+          size_t page_idx = pg_no (e) - pg_no (base);
+          size_t block_cnt = (size_t) 1 << order;
+          size_t chunk_idx;
+
+          for (chunk_idx = page_idx; chunk_idx < page_idx + block_cnt;
+               chunk_idx += CHUNK_PAGES)
+            if (!foreign || chunk_home[chunk_idx / CHUNK_PAGES] != pool) 
+              {
+                /* Take the whole block off the free lists, then
+                   put back everything except our chunk. */
+                list_remove (e);
+                page_order[page_idx] = NOT_FREE;
+                pool->free_cnt -= block_cnt;
+                buddy_free (pool, page_idx, chunk_idx - page_idx);
+                buddy_free (pool, chunk_idx + CHUNK_PAGES,
+                            page_idx + block_cnt - chunk_idx - CHUNK_PAGES);
+
+                pool->page_cnt -= CHUNK_PAGES;
+                if (chunk_home[chunk_idx / CHUNK_PAGES] != pool)
+                  pool->borrowed_cnt--;
+                chunk_owner[chunk_idx / CHUNK_PAGES] = NULL;
+                return chunk_idx;
+              }
+        }
+    }
+  return BITMAP_ERROR;
+}
+
+/* Makes POOL the owner of the free chunk starting at PAGE_IDX,
+   which no pool owns. */
+static void
+give_chunk (struct pool *pool, size_t page_idx) 
+{
+  lock_acquire (&pool->lock);
+  ASSERT (chunk_owner[page_idx / CHUNK_PAGES] == NULL);
+  chunk_owner[page_idx / CHUNK_PAGES] = pool;
+  pool->page_cnt += CHUNK_PAGES;
+  if (chunk_home[page_idx / CHUNK_PAGES] != pool)
+    pool->borrowed_cnt++;
+  buddy_free (pool, page_idx, CHUNK_PAGES);
+  lock_release (&pool->lock);
+}
+
+/* Returns the free block at PAGE_IDX. */
+static struct free_block *
+block_at (size_t page_idx) 
+{
+  return (struct free_block *) (base + PGSIZE * page_idx);
+}
+
+/* Adds the block of 2**ORDER pages at PAGE_IDX in POOL to the
+   free lists, merging it with its buddies as far as possible. */
+static void
+free_block (struct pool *pool, size_t page_idx, int order) 
+{
+  while (order < MAX_ORDER) 
+    {
+      size_t buddy_idx = page_idx ^ ((size_t) 1 << order);
+      if (buddy_idx >= total_pages
+          || (order >= CHUNK_ORDER
+              && chunk_owner[buddy_idx / CHUNK_PAGES] != pool)
+          || page_order[buddy_idx] != order)
+        break;
+
+      list_remove (&block_at (buddy_idx)->elem);
+      page_order[buddy_idx] = NOT_FREE;
+      page_idx &= ~((size_t) 1 << order);
+      order++;
+    }
+
+  page_order[page_idx] = order;
+  list_push_front (&pool->free_lists[order], &block_at (page_idx)->elem);
+}
+
+/* Frees the PAGE_CNT pages starting at PAGE_IDX in POOL, by
+   breaking them into the largest aligned blocks that fit.  The
+   caller must hold POOL's lock. */
+static void
+buddy_free (struct pool *pool, size_t page_idx, size_t page_cnt) 
+{
+  pool->free_cnt += page_cnt;
+  while (page_cnt > 0) 
+    {
+      int order = 0;
+      while (order < MAX_ORDER
+             && (page_idx & ((size_t) 1 << order)) == 0
+             && ((size_t) 2 << order) <= page_cnt)
+        order++;
+
+      free_block (pool, page_idx, order);
+      page_idx += (size_t) 1 << order;
+      page_cnt -= (size_t) 1 << order;
+    }
+}
+
+/* Allocates PAGE_CNT contiguous pages from POOL and returns the
+   index of the first, or BITMAP_ERROR if no free block is large
+   enough.  The caller must hold POOL's lock. */
+static size_t
+buddy_alloc (struct pool *pool, size_t page_cnt) 
+{
+  int order = 0;
+  int have;
+  size_t page_idx;
+
+  while (((size_t) 1 << order) < page_cnt)
+    if (++order > MAX_ORDER)
+      return BITMAP_ERROR;
+
+  /* Find the smallest free block that is large enough. */
+  for (have = order; have <= MAX_ORDER; have++)
+    if (!list_empty (&pool->free_lists[have]))
+      break;
+  if (have > MAX_ORDER)
+    return BITMAP_ERROR;
+
+  page_idx = pg_no (list_pop_front (&pool->free_lists[have])) - pg_no (base);
+  page_order[page_idx] = NOT_FREE;
+  pool->free_cnt -= (size_t) 1 << have;
+
+  /* Split it down to the requested order, freeing the upper
+     halves. */
+  while (have > order) 
+    {
+      have--;
+      free_block (pool, page_idx + ((size_t) 1 << have), have);
+      pool->free_cnt += (size_t) 1 << have;
+    }
 
-  return page_no >= start_page && page_no < end_page;
+  /* Give back the tail beyond PAGE_CNT. */
+  buddy_free (pool, page_idx + page_cnt, ((size_t) 1 << order) - page_cnt);
+  return page_idx;
 }
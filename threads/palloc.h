@@ -1,6 +1,7 @@
 #ifndef THREADS_PALLOC_H
 #define THREADS_PALLOC_H
 
+#include <stdbool.h>
 #include <stddef.h>
 
 /* How to allocate pages. */
@@ -11,10 +12,25 @@ enum palloc_flags
     PAL_USER = 004              /* User page. */
   };
 
+/* Page allocator statistics for one pool, in pages. */
+struct palloc_stats
+  {
+    size_t page_cnt;            /* Pages owned by the pool. */
+    size_t free_cnt;            /* Free pages. */
+    size_t zeroed_cnt;          /* Free pages kept pre-zeroed. */
+    size_t borrowed_cnt;        /* Pages borrowed from the other pool. */
+    size_t used_cnt;            /* Pages in use. */
+    size_t peak_cnt;            /* Maximum used_cnt so far. */
+    size_t fail_cnt;            /* Failed allocations. */
+  };
+
 void palloc_init (size_t user_page_limit);
 void *palloc_get_page (enum palloc_flags);
 void *palloc_get_multiple (enum palloc_flags, size_t page_cnt);
 void palloc_free_page (void *);
 void palloc_free_multiple (void *, size_t page_cnt);
+bool palloc_prezero (void);
+void palloc_get_stats (enum palloc_flags, struct palloc_stats *);
+void palloc_print_stats (void);
 
 #endif /* threads/palloc.h */
@@ -0,0 +1,74 @@
+#include "threads/shrinker.h"
+#include <debug.h>
+#include "threads/interrupt.h"
+#include "threads/synch.h"
+
+/* Shrinkers.
+
+   Subsystems that keep memory around for speed, such as object
+   caches, register a shrinker that releases some of it.  When
+   the page allocator is about to fail a request, it calls
+   shrink_caches(), which runs the shrinkers in turn until enough
+   memory has been freed, and then retries.  Only one thread
+   shrinks at a time, and an allocation made by a shrinker never
+   triggers shrinking again. */
+
+/* Registered shrinkers.  Protected by shrink_lock. */
+static struct list shrinkers = LIST_INITIALIZER (shrinkers);
+
+/* Held while shrinking. */
+static struct lock shrink_lock;
+
+/* Initializes the shrinker registry. */
+void
+shrinker_init (void) 
+{
+  lock_init (&shrink_lock);
+}
+
+/* Adds S to the set of shrinkers. */
+void
+shrinker_register (struct shrinker *s) 
+{
+  ASSERT (s != NULL && s->shrink != NULL);
+
+  lock_acquire (&shrink_lock);
+  list_push_back (&shrinkers, &s->elem);
+  lock_release (&shrink_lock);
+}
+
+/* Removes S from the set of shrinkers. */
+void
+shrinker_unregister (struct shrinker *s) 
+{
+  lock_acquire (&shrink_lock);
+  list_remove (&s->elem);
+  lock_release (&shrink_lock);
+}
+
+/* Runs the registered shrinkers until they have freed at least
+   PAGE_CNT pages or all of them have run.  Returns the number of
+   pages freed, which is 0 if this thread is already shrinking
+   or it is too early in boot to shrink. */
+size_t
+shrink_caches (size_t page_cnt) 
+{
+  struct list_elem *e;
+  size_t freed = 0;
+
+  if (list_empty (&shrinkers) || intr_context ()
+      || lock_held_by_current_thread (&shrink_lock))
+    return 0;
+
+  lock_acquire (&shrink_lock);
+  for (e = list_begin (&shrinkers); e != list_end (&shrinkers);
+       e = list_next (e)) 
+    {
+      struct shrinker *s = list_entry (e, struct shrinker, elem);
+      freed += s->shrink (page_cnt - freed);
+      if (freed >= page_cnt)
+        break;
+    }
+  lock_release (&shrink_lock);
+  return freed;
+}
@@ -0,0 +1,31 @@
+#ifndef THREADS_SHRINKER_H
+#define THREADS_SHRINKER_H
+
+#include <list.h>
+#include <stddef.h>
+
+/* Asks a cache to give back about PAGE_CNT pages of memory.
+   Returns the number of pages actually freed.
+
+   A shrinker runs inside the allocation that is failing, so the
+   allocating thread may hold any lock at all.  A shrinker must
+   therefore never wait for a lock that such a thread might hold:
+   it should use lock_try_acquire() (after checking that the
+   current thread does not already hold the lock) and give up if
+   that fails. */
+typedef size_t shrink_func (size_t page_cnt);
+
+/* A shrinker. */
+struct shrinker 
+  {
+    const char *name;           /* Name, for debugging. */
+    shrink_func *shrink;        /* Callback. */
+    struct list_elem elem;      /* List element. */
+  };
+
+void shrinker_init (void);
+void shrinker_register (struct shrinker *);
+void shrinker_unregister (struct shrinker *);
+size_t shrink_caches (size_t page_cnt);
+
+#endif /* threads/shrinker.h */
@@ -0,0 +1,322 @@
+#include "threads/slab.h"
+#include <debug.h>
+#include <list.h>
+#include <round.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include "threads/interrupt.h"
+#include "threads/palloc.h"
+#include "threads/shrinker.h"
+#include "threads/synch.h"
+#include "threads/vaddr.h"
+
+/* Slab allocator.
+
+   An object cache hands out objects of a single size.  Its
+   memory comes in "slabs" of one page each, obtained from the
+   page allocator.  A slab holds a header followed by as many
+   objects as fit, packed at their exact (word-aligned) size, so
+   that for example a 560-byte inode costs 560 bytes rather than
+   malloc()'s 1 kB.  An object's slab is found by rounding its
+   address down to a page boundary.
+
+   Slabs with at least one free object are kept on the cache's
+   list of partial slabs.  When a slab becomes completely free it
+   is given back to the page allocator, unless it is the cache's
+   only partial slab.
+
+   In front of the slabs, each cache has a "magazine": a small
+   stack of recently freed objects.  Allocating from or freeing
+   to the magazine only needs interrupts to be turned off for a
+   moment, rather than the cache lock, which makes the common
+   case of an object being freed and soon reallocated cheap.
+
+   Under memory pressure, a shrinker empties the magazines and
+   frees every completely free slab. */
+
+/* Objects held in a cache's magazine. */
+#define MAGAZINE_SIZE 16
+
+/* Most caches that may be created. */
+#define MAX_CACHES 16
+
+/* Object cache. */
+struct kmem_cache 
+  {
+    const char *name;           /* Name, for debugging. */
+    size_t obj_size;            /* Size of each object in bytes. */
+    size_t objs_per_slab;       /* Number of objects in a slab. */
+    kmem_ctor_func *ctor;       /* Constructor, or null. */
+    struct lock lock;           /* Protects partial_slabs. */
+    struct list partial_slabs;  /* Slabs with free objects. */
+
+    /* Magazine.  Protected by disabling interrupts. */
+    void *magazine[MAGAZINE_SIZE];
+    size_t magazine_cnt;
+  };
+
+/* Magic number for detecting slab corruption. */
+#define SLAB_MAGIC 0x51ab51ab
+
+/* Slab header, at the start of each slab page. */
+struct slab 
+  {
+    unsigned magic;             /* Always set to SLAB_MAGIC. */
+    struct kmem_cache *cache;   /* Owning cache. */
+    struct list_elem elem;      /* Element in partial_slabs. */
+    size_t free_cnt;            /* Number of free objects. */
+    void *free_objs;            /* Singly linked list of free objects. */
+  };
+
+/* Our caches. */
+static struct kmem_cache caches[MAX_CACHES];
+static size_t cache_cnt;
+
+static void *slab_alloc (struct kmem_cache *);
+static void slab_free (struct kmem_cache *, void *);
+static void slab_put (struct kmem_cache *, void *);
+static size_t shrink_cache (struct kmem_cache *);
+static shrink_func slab_shrink;
+
+/* Shrinker for all the caches. */
+static struct shrinker slab_shrinker = { "slab", slab_shrink, { NULL, NULL } };
+
+/* Initializes the slab allocator. */
+void
+kmem_init (void) 
+{
+  shrinker_register (&slab_shrinker);
+}
+static struct slab *obj_to_slab (void *);
+static struct slab *new_slab (struct kmem_cache *);
+
+/* Creates and returns a cache of SIZE-byte objects named NAME.
+   If CTOR is nonnull, it is called to initialize each object
+   that is allocated.  Panics if SIZE is too big for a slab or if
+   too many caches have been created. */
+struct kmem_cache *
+kmem_cache_create (const char *name, size_t size, kmem_ctor_func *ctor) 
+{
+  struct kmem_cache *c;
+
+  if (cache_cnt >= MAX_CACHES)
+    PANIC ("too many object caches creating %s", name);
+  c = &caches[cache_cnt++];
+
+  c->name = name;
+  c->obj_size = ROUND_UP (size > sizeof (void *) ? size : sizeof (void *),
+                          sizeof (void *));
+  c->objs_per_slab = (PGSIZE - sizeof (struct slab)) / c->obj_size;
+  if (c->objs_per_slab == 0)
+    PANIC ("%zu-byte objects in %s too big for a slab", size, name);
+  c->ctor = ctor;
+  lock_init (&c->lock);
+  list_init (&c->partial_slabs);
+  c->magazine_cnt = 0;
+  return c;
+}
+
+/* Obtains and returns an object from cache C.  The object's
+   contents are undefined unless C has a constructor.  Returns a
+   null pointer if memory is not available. */
+void *
+kmem_cache_alloc (struct kmem_cache *c) 
+{
+  enum intr_level old_level;
+  void *obj = NULL;
+
+  /* Try the magazine first. */
+  old_level = intr_disable ();
+  if (c->magazine_cnt > 0)
+    obj = c->magazine[--c->magazine_cnt];
+  intr_set_level (old_level);
+
+  if (obj == NULL)
+    obj = slab_alloc (c);
+  if (obj != NULL && c->ctor != NULL)
+    c->ctor (obj);
+  return obj;
+}
+
+/* Returns OBJ, which must have been obtained from cache C, to
+   the cache.  If OBJ is a null pointer, does nothing. */
+void
+kmem_cache_free (struct kmem_cache *c, void *obj) 
+{
+  enum intr_level old_level;
+  bool stored = false;
+
+  if (obj == NULL)
+    return;
+  ASSERT (obj_to_slab (obj)->cache == c);
+
+  old_level = intr_disable ();
+  if (c->magazine_cnt < MAGAZINE_SIZE) 
+    {
+      c->magazine[c->magazine_cnt++] = obj;
+      stored = true;
+    }
+  intr_set_level (old_level);
+
+  if (!stored)
+    slab_free (c, obj);
+}
+
+/* Takes a free object from one of C's slabs, creating a new
+   slab if necessary.  Returns a null pointer if memory is not
+   available. */
+static void *
+slab_alloc (struct kmem_cache *c) 
+{
+  struct slab *s;
+  void *obj;
+
+  lock_acquire (&c->lock);
+  if (!list_empty (&c->partial_slabs))
+    s = list_entry (list_front (&c->partial_slabs), struct slab, elem);
+  else 
+    {
+      s = new_slab (c);
+      if (s == NULL) 
+        {
+          lock_release (&c->lock);
+          return NULL;
+        }
+      list_push_front (&c->partial_slabs, &s->elem);
+    }
+
+  obj = s->free_objs;
+  s->free_objs = *(void **) obj;
+  if (--s->free_cnt == 0)
+    list_remove (&s->elem);
+  lock_release (&c->lock);
+  return obj;
+}
+
+/* Returns OBJ to its slab in C, and frees the slab if it is now
+   empty and C has other partial slabs. */
+static void
+slab_free (struct kmem_cache *c, void *obj) 
+{
+  struct slab *s = obj_to_slab (obj);
+
+  lock_acquire (&c->lock);
+  slab_put (c, obj);
+  if (s->free_cnt == c->objs_per_slab
+      && list_size (&c->partial_slabs) > 1) 
+    {
+      list_remove (&s->elem);
+      s->magic = 0;
+      palloc_free_page (s);
+    }
+  lock_release (&c->lock);
+}
+
+/* Puts OBJ back on its slab's free list.  The caller must hold
+   C's lock. */
+static void
+slab_put (struct kmem_cache *c, void *obj) 
+{
+  struct slab *s = obj_to_slab (obj);
+
+  *(void **) obj = s->free_objs;
+  s->free_objs = obj;
+  if (++s->free_cnt == 1)
+    list_push_front (&c->partial_slabs, &s->elem);
+}
+
+/* Empties C's magazine and frees all of its free slabs.  Returns
+   the number of pages freed.  The caller must hold C's lock. */
+static size_t
+shrink_cache (struct kmem_cache *c) 
+{
+  void *objs[MAGAZINE_SIZE];
+  size_t obj_cnt, i;
+  enum intr_level old_level;
+  struct list_elem *e;
+  size_t freed = 0;
+
+  old_level = intr_disable ();
+  obj_cnt = c->magazine_cnt;
+  for (i = 0; i < obj_cnt; i++)
+    objs[i] = c->magazine[i];
+  c->magazine_cnt = 0;
+  intr_set_level (old_level);
+  for (i = 0; i < obj_cnt; i++)
+    slab_put (c, objs[i]);
+
+  for (e = list_begin (&c->partial_slabs); e != list_end (&c->partial_slabs); )
+    {
+      struct slab *s = list_entry (e, struct slab, elem);
+      e = list_next (e);
+      if (s->free_cnt == c->objs_per_slab) 
+        {
+          list_remove (&s->elem);
+          s->magic = 0;
+          palloc_free_page (s);
+          freed++;
+        }
+    }
+  return freed;
+}
+
+/* Shrinker for the slab allocator.  Shrinks every cache whose
+   lock is free, regardless of PAGE_CNT, since there is no point
+   in keeping free slabs around under memory pressure. */
+static size_t
+slab_shrink (size_t page_cnt UNUSED) 
+{
+  size_t freed = 0;
+  size_t i;
+
+  for (i = 0; i < cache_cnt; i++) 
+    {
+      struct kmem_cache *c = &caches[i];
+      if (!lock_held_by_current_thread (&c->lock)
+          && lock_try_acquire (&c->lock)) 
+        {
+          freed += shrink_cache (c);
+          lock_release (&c->lock);
+        }
+    }
+  return freed;
+}
+
+/* Returns the slab that OBJ belongs to. */
+static struct slab *
+obj_to_slab (void *obj) 
+{
+  struct slab *s = pg_round_down (obj);
+  ASSERT (s != NULL);
+  ASSERT (s->magic == SLAB_MAGIC);
+  ASSERT ((uintptr_t) obj - (uintptr_t) (s + 1) < PGSIZE);
+  return s;
+}
+
+/* Obtains a page and sets it up as a slab for cache C, with all
+   of its objects free.  Returns a null pointer if memory is not
+   available. */
+static struct slab *
+new_slab (struct kmem_cache *c) 
+{
+  struct slab *s = palloc_get_page (0);
+  uint8_t *objs;
+  size_t i;
+
+  if (s == NULL)
+    return NULL;
+
+  s->magic = SLAB_MAGIC;
+  s->cache = c;
+  s->free_cnt = c->objs_per_slab;
+  s->free_objs = NULL;
+
+  objs = (uint8_t *) (s + 1);
+  for (i = c->objs_per_slab; i-- > 0; ) 
+    {
+      void *obj = objs + i * c->obj_size;
+      *(void **) obj = s->free_objs;
+      s->free_objs = obj;
+    }
+  return s;
+}
@@ -8,6 +8,7 @@
 #include "threads/interrupt.h"
 #include "threads/intr-stubs.h"
 #include "threads/palloc.h"
+#include "threads/shrinker.h"
 #include "threads/switch.h"
 #include "threads/synch.h"
 #include "threads/vaddr.h"
@@ -29,6 +30,12 @@ static struct list ready_list;
    when they are first scheduled and removed when they exit. */
 static struct list all_list;
 
+/* Hash table of all processes, by tid.  Tids are handed out in
+   order, so TID % TID_BUCKETS spreads them evenly over the
+   buckets.  Like all_list, protected by disabling interrupts. */
+#define TID_BUCKETS 64
+static struct list tid_buckets[TID_BUCKETS];
+
 /* Idle thread. */
 static struct thread *idle_thread;
 
@@ -38,6 +45,21 @@ static struct thread *initial_thread;
 /* Lock used by allocate_tid(). */
 static struct lock tid_lock;
 
+/* Pages of dead threads, kept for reuse by thread_create().
+   Only the struct thread at the start of a page has to be reset
+   before reuse, so recycling a page saves both a trip through
+   the page allocator and clearing the whole page.  Each page
+   starts with a list_elem.  Protected by disabling interrupts. */
+static struct list page_cache;
+static size_t page_cache_cnt;
+
+/* Most pages to keep in page_cache. */
+#define PAGE_CACHE_MAX 8
+
+static size_t shrink_page_cache (size_t page_cnt);
+static struct shrinker page_cache_shrinker =
+  { "thread pages", shrink_page_cache, { NULL, NULL } };
+
 /* Stack frame for kernel_thread(). */
 struct kernel_thread_frame 
   {
@@ -68,9 +90,11 @@ static struct thread *next_thread_to_run (void);
 static void init_thread (struct thread *, const char *name, int priority);
 static bool is_thread (struct thread *) UNUSED;
 static void *alloc_frame (struct thread *, size_t size);
+static void add_tid (struct thread *);
 static void schedule (void);
 void thread_schedule_tail (struct thread *prev);
 static tid_t allocate_tid (void);
+static struct thread *alloc_thread_page (void);
 
 //struct thread *get_thread_with_tid(tid_t tid);
 /* Initializes the threading system by transforming the code
@@ -86,35 +110,52 @@ static tid_t allocate_tid (void);
 void
 thread_init (void) 
 {
+  int i;
+
   ASSERT (intr_get_level () == INTR_OFF);
 
   lock_init (&tid_lock);
   list_init (&ready_list);
   list_init (&all_list);
+  list_init (&page_cache);
+  for (i = 0; i < TID_BUCKETS; i++)
+    list_init (&tid_buckets[i]);
 
   /* Set up a thread structure for the running thread. */
   initial_thread = running_thread ();
   init_thread (initial_thread, "main", PRI_DEFAULT);
   initial_thread->status = THREAD_RUNNING;
   initial_thread->tid = allocate_tid ();
+  add_tid (initial_thread);
   initial_thread->current_working_dir = NULL;
 }
 
 
 
 
-struct thread* get_thread_with_tid(tid_t tid){
-	struct list_elem *e;
-struct thread *t;	
-	for(e = list_begin(&all_list); e != list_end(&all_list); e = list_next(e)){
-	
-	t = list_entry(e, struct thread, allelem);
-		if(t->tid==tid){
-			return t;
-		}
-	}
-	return NULL;
-	}
+/* Returns the live thread with the given TID, or a null pointer
+   if there is none. */
+struct thread *
+get_thread_with_tid (tid_t tid) 
+{
+  struct list *bucket = &tid_buckets[(unsigned) tid % TID_BUCKETS];
+  struct thread *found = NULL;
+  enum intr_level old_level;
+  struct list_elem *e;
+
+  old_level = intr_disable ();
+  for (e = list_begin (bucket); e != list_end (bucket); e = list_next (e))
+    {
+      struct thread *t = list_entry (e, struct thread, tid_elem);
+      if (t->tid == tid) 
+        {
+          found = t;
+          break;
+        }
+    }
+  intr_set_level (old_level);
+  return found;
+}
 /* Starts preemptive thread scheduling by enabling interrupts.
    Also creates the idle thread. */
 
@@ -126,6 +167,8 @@ thread_start (void)
   sema_init (&idle_started, 0);
   thread_create ("idle", PRI_MIN, idle, &idle_started);
 
+  shrinker_register (&page_cache_shrinker);
+
   /* Start preemptive thread scheduling. */
   intr_enable ();
 
@@ -189,13 +232,14 @@ thread_create (const char *name, int priority,
   ASSERT (function != NULL);
 
   /* Allocate thread. */
-  t = palloc_get_page (PAL_ZERO);
+  t = alloc_thread_page ();
   if (t == NULL)
     return TID_ERROR;
 
   /* Initialize thread. */
   init_thread (t, name, priority);
   tid = t->tid = allocate_tid ();
+  add_tid (t);
 
   /* Stack frame for kernel_thread(). */
   kf = alloc_frame (t, sizeof *kf);
@@ -315,6 +359,7 @@ thread_exit (void)
   intr_disable ();
   remove_locks();
   list_remove (&thread_current()->allelem);
+  list_remove (&thread_current()->tid_elem);
   thread_current ()->status = THREAD_DYING;
   schedule ();
   NOT_REACHED ();
@@ -421,6 +466,16 @@ idle (void *idle_started_ UNUSED)
       intr_disable ();
       thread_block ();
 
+      /* Nothing else is ready, so use the time to clear free
+         pages for later PAL_ZERO requests, stopping as soon as an
+         interrupt makes another thread ready. */
+      intr_enable ();
+      while (list_empty (&ready_list) && palloc_prezero ())
+        continue;
+      intr_disable ();
+      if (!list_empty (&ready_list))
+        continue;
+
       /* Re-enable interrupts and wait for the next one.
          The `sti' instruction disables interrupts until the
          completion of the next instruction, so these two
@@ -485,8 +540,9 @@ init_thread (struct thread *t, const char *name, int priority)
   t->priority = priority;
   t->magic = THREAD_MAGIC;
   list_init(&t->lock_list);  
-  t->handle = 2;
-  list_init(&t->file_lists);
+  t->fds = NULL;
+  t->fd_cnt = 0;
+  t->fd_free = 2;
   
   list_init(&t->child_processes);
   t->process_status = NULL;
@@ -563,7 +619,13 @@ thread_schedule_tail (struct thread *prev)
   if (prev != NULL && prev->status == THREAD_DYING && prev != initial_thread) 
     {
       ASSERT (prev != cur);
-      palloc_free_page (prev);
+      if (page_cache_cnt < PAGE_CACHE_MAX) 
+        {
+          list_push_front (&page_cache, (struct list_elem *) prev);
+          page_cache_cnt++;
+        }
+      else
+        palloc_free_page (prev);
     }
 }
 
@@ -589,6 +651,56 @@ schedule (void)
   thread_schedule_tail (prev);
 }
 
+/* Returns a page for a new thread, reusing a dead thread's page
+   if one is cached, or a null pointer if memory is exhausted.
+   init_thread() clears the struct thread at the start of the
+   page; the rest of the page is the new thread's stack, whose
+   old contents do not matter. */
+static struct thread *
+alloc_thread_page (void) 
+{
+  struct thread *t = NULL;
+  enum intr_level old_level;
+
+  old_level = intr_disable ();
+  if (!list_empty (&page_cache)) 
+    {
+      t = (struct thread *) list_pop_front (&page_cache);
+      page_cache_cnt--;
+    }
+  intr_set_level (old_level);
+
+  if (t == NULL)
+    t = palloc_get_page (0);
+  return t;
+}
+
+/* Shrinker for the thread page cache: frees up to PAGE_CNT
+   cached pages and returns the number freed. */
+static size_t
+shrink_page_cache (size_t page_cnt) 
+{
+  size_t freed = 0;
+
+  while (freed < page_cnt) 
+    {
+      enum intr_level old_level = intr_disable ();
+      void *page = NULL;
+      if (!list_empty (&page_cache)) 
+        {
+          page = list_pop_front (&page_cache);
+          page_cache_cnt--;
+        }
+      intr_set_level (old_level);
+
+      if (page == NULL)
+        break;
+      palloc_free_page (page);
+      freed++;
+    }
+  return freed;
+}
+
 /* Returns a tid to use for a new thread. */
 static tid_t
 allocate_tid (void) 
@@ -603,13 +715,17 @@ allocate_tid (void)
   return tid;
 }
 
+/* Adds T, whose tid has been set, to the tid hash table. */
+static void
+add_tid (struct thread *t) 
+{
+  enum intr_level old_level = intr_disable ();
+  list_push_back (&tid_buckets[(unsigned) t->tid % TID_BUCKETS], &t->tid_elem);
+  intr_set_level (old_level);
+}
+
 bool thread_dead(int tid){
-	struct list_elem * i;
-	for (i = list_begin(&all_list); i != list_end(&all_list); i = list_next(i)){
-		struct thread * t = list_entry(i, struct thread, allelem);
-		if(t->tid == tid){return true;}
-	}
-	return false;
+	return get_thread_with_tid(tid) != NULL;
 }
 
 /* Offset of `stack' member within `struct thread'.
@@ -81,12 +81,14 @@ typedef int tid_t;
 
 struct status {
 	tid_t tid;
+	tid_t parent;			/* Tid of the process that owns this. */
 	struct semaphore dead;
 	struct semaphore load;
 	int loaded;
 	bool died;
 	bool waiting;
 	struct list_elem elem;
+	struct list_elem tid_elem;	/* Element in process.c's status table. */
 	int exit_status;
 };
 struct thread
@@ -98,6 +100,7 @@ struct thread
     uint8_t *stack;                     /* Saved stack pointer. */
     int priority;                       /* Priority. */
     struct list_elem allelem;           /* List element for all threads list. */
+    struct list_elem tid_elem;          /* List element for tid hash table. */
 	/* Shared between thread.c and synch.c. */
     struct list_elem elem;              /* List element. */
 	struct file *rox;
@@ -111,9 +114,10 @@ struct thread
     /* Owned by thread.c. */
     unsigned magic;                     /* Detects stack overflow. */
 
-/* LIST OF FILES: shows all the files a thread is using or could handle is set to 2+*/
-	struct list file_lists;
-	int handle;
+/* TABLE OF FILES: open files indexed by handle, 0 and 1 are the console */
+	struct fd_elem **fds;               /* Null where a handle is free. */
+	int fd_cnt;                         /* Number of slots in fds. */
+	int fd_free;                        /* No free handle below this. */
 
 	tid_t parent;
 /* LIST OF CHILDPROCESSES OF THREAD*/
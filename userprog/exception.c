@@ -2,6 +2,8 @@
 #include <inttypes.h>
 #include <stdio.h>
 #include "userprog/gdt.h"
+#include "userprog/pagedir.h"
+#include "userprog/uaccess.h"
 #include "threads/interrupt.h"
 #include "threads/thread.h"
 #include "userprog/syscall.h"
@@ -148,6 +150,25 @@ page_fault (struct intr_frame *f)
   not_present = (f->error_code & PF_P) == 0;
   write = (f->error_code & PF_W) != 0;
   user = (f->error_code & PF_U) != 0;
+
+  /* A write to a copy-on-write page, from user code or from the
+     kernel on the user's behalf, just needs a private frame. */
+  if (!not_present && write && thread_current ()->pagedir != NULL
+      && pagedir_cow_fault (thread_current ()->pagedir, fault_addr))
+    return;
+
+  /* A fault in the kernel while copying to or from user memory
+     makes the copy fail rather than the kernel. */
+  if (!user) 
+    {
+      uintptr_t fixup = uaccess_fixup ((uintptr_t) f->eip);
+      if (fixup != 0) 
+        {
+          f->eip = (void (*) (void)) fixup;
+          return;
+        }
+    }
+
   /*check only that a user pointer points below PHYS_BASE then derefrence it an invalid user pointer will cause a "page fault" that you can handle by modifying the code for page_fault() in this file. This techineqe is normally faster. */
   if(user){exit(-1);}
   /* To implement virtual memory, delete the rest of the function
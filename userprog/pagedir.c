@@ -2,12 +2,46 @@
 #include <stdbool.h>
 #include <stddef.h>
 #include <string.h>
+#include <round.h>
 #include "threads/init.h"
 #include "threads/pte.h"
 #include "threads/palloc.h"
+#include "threads/synch.h"
 
 static uint32_t *active_pd (void);
 static void invalidate_pagedir (uint32_t *);
+static uint32_t *lookup_page (uint32_t *pd, const void *vaddr, bool create);
+static void release_frame (void *kpage);
+
+/* A single read-only frame of zeros, shared by every untouched
+   zero-fill page of every process.  Never freed. */
+static void *zero_page;
+
+/* Frames shared between page directories by pagedir_fork(),
+   indexed by physical page number.  Each entry counts the
+   mappings of the frame beyond the first, so 0 means the frame
+   has a single owner and may be written or freed directly. */
+static uint16_t *frame_shares;
+static struct lock share_lock;
+
+/* Returns the share count of frame KPAGE. */
+static inline uint16_t *
+frame_share (void *kpage)
+{
+  return &frame_shares[vtop (kpage) >> PGBITS];
+}
+
+/* Allocates the shared zero page and the frame share counts. */
+void
+pagedir_init (void)
+{
+  size_t share_pages = DIV_ROUND_UP (init_ram_pages * sizeof *frame_shares,
+                                     PGSIZE);
+
+  zero_page = palloc_get_page (PAL_ASSERT | PAL_ZERO);
+  frame_shares = palloc_get_multiple (PAL_ASSERT | PAL_ZERO, share_pages);
+  lock_init (&share_lock);
+}
 
 /* Creates a new page directory that has mappings for kernel
    virtual addresses, but none for user virtual addresses.
@@ -41,12 +75,89 @@ pagedir_destroy (uint32_t *pd)
         
         for (pte = pt; pte < pt + PGSIZE / sizeof *pte; pte++)
           if (*pte & PTE_P) 
-            palloc_free_page (pte_get_page (*pte));
+            release_frame (pte_get_page (*pte));
         palloc_free_page (pt);
       }
   palloc_free_page (pd);
 }
 
+/* Creates a copy of page directory PD for a forked process.
+   No user page is copied.  Writable pages become read-only in
+   both directories with PTE_COW set, so that whichever process
+   writes one first gets a copy of its own in
+   pagedir_cow_fault().  Read-only pages are simply shared.
+   Returns the new page directory, or a null pointer if memory
+   allocation fails. */
+uint32_t *
+pagedir_fork (uint32_t *pd) 
+{
+  uint32_t *child;
+  uint32_t *pde;
+
+  ASSERT (pd != init_page_dir);
+
+  child = pagedir_create ();
+  if (child == NULL)
+    return NULL;
+
+  for (pde = pd; pde < pd + pd_no (PHYS_BASE); pde++)
+    if (*pde & PTE_P) 
+      {
+        uint32_t *pt = pde_get_pt (*pde);
+        uint32_t *pte;
+
+        for (pte = pt; pte < pt + PGSIZE / sizeof *pte; pte++)
+          if (*pte & PTE_P) 
+            {
+              void *upage = (void *) (((uintptr_t) (pde - pd) << PDSHIFT)
+                                      | ((uintptr_t) (pte - pt) << PTSHIFT));
+              void *kpage = pte_get_page (*pte);
+              uint32_t *child_pte = lookup_page (child, upage, true);
+
+              if (child_pte == NULL) 
+                {
+                  pagedir_destroy (child);
+                  invalidate_pagedir (pd);
+                  return NULL;
+                }
+
+              if (*pte & PTE_W)
+                *pte = (*pte & ~(uint32_t) PTE_W) | PTE_COW;
+              if (kpage != zero_page) 
+                {
+                  lock_acquire (&share_lock);
+                  (*frame_share (kpage))++;
+                  lock_release (&share_lock);
+                }
+              *child_pte = *pte & ~(uint32_t) (PTE_A | PTE_D);
+            }
+      }
+
+  /* The parent lost write access to its pages. */
+  invalidate_pagedir (pd);
+  return child;
+}
+
+/* Drops one mapping of frame KPAGE, freeing the frame if that
+   was the last one. */
+static void
+release_frame (void *kpage) 
+{
+  bool last;
+
+  if (kpage == zero_page)
+    return;
+
+  lock_acquire (&share_lock);
+  last = *frame_share (kpage) == 0;
+  if (!last)
+    (*frame_share (kpage))--;
+  lock_release (&share_lock);
+
+  if (last)
+    palloc_free_page (kpage);
+}
+
 /* Returns the address of the page table entry for virtual
    address VADDR in page directory PD.
    If PD does not have a page table for VADDR, behavior depends
@@ -118,6 +229,82 @@ pagedir_set_page (uint32_t *pd, void *upage, void *kpage, bool writable)
     return false;
 }
 
+/* Adds a mapping in page directory PD from user virtual page
+   UPAGE to the shared zero page.  The mapping is always
+   read-only in hardware; if WRITABLE is true, the first write
+   to UPAGE faults and pagedir_cow_fault() replaces the zero page
+   by a private, zeroed frame.
+   UPAGE must not already be mapped.
+   Returns true if successful, false if memory allocation
+   failed. */
+bool
+pagedir_set_zero_page (uint32_t *pd, void *upage, bool writable)
+{
+  uint32_t *pte;
+
+  ASSERT (pg_ofs (upage) == 0);
+  ASSERT (is_user_vaddr (upage));
+  ASSERT (zero_page != NULL);
+  ASSERT (pd != init_page_dir);
+
+  pte = lookup_page (pd, upage, true);
+
+  if (pte != NULL) 
+    {
+      ASSERT ((*pte & PTE_P) == 0);
+      *pte = pte_create_user (zero_page, false) | (writable ? PTE_COW : 0);
+      return true;
+    }
+  else
+    return false;
+}
+
+/* Resolves a write fault on user virtual address UADDR in PD.
+   If UADDR lies in a copy-on-write page, gives that page a
+   private frame of its own (unless it is already the last
+   mapping of its frame), maps it writable, and returns true.
+   Returns false if the fault is not a copy-on-write fault or if
+   no frame is available, in which case the fault is genuine. */
+bool
+pagedir_cow_fault (uint32_t *pd, const void *uaddr)
+{
+  uint32_t *pte;
+  void *kpage, *copy;
+
+  if (!is_user_vaddr (uaddr))
+    return false;
+
+  pte = lookup_page (pd, uaddr, false);
+  if (pte == NULL || (*pte & (PTE_P | PTE_COW)) != (PTE_P | PTE_COW))
+    return false;
+
+  kpage = pte_get_page (*pte);
+  if (kpage == zero_page)
+    copy = palloc_get_page (PAL_USER | PAL_ZERO);
+  else
+    {
+      lock_acquire (&share_lock);
+      if (*frame_share (kpage) == 0)
+        copy = kpage;
+      else
+        {
+          copy = palloc_get_page (PAL_USER);
+          if (copy != NULL) 
+            {
+              memcpy (copy, kpage, PGSIZE);
+              (*frame_share (kpage))--;
+            }
+        }
+      lock_release (&share_lock);
+    }
+  if (copy == NULL)
+    return false;
+
+  *pte = pte_create_user (copy, true);
+  invalidate_pagedir (pd);
+  return true;
+}
+
 /* Looks up the physical address that corresponds to user virtual
    address UADDR in PD.  Returns the kernel virtual address
    corresponding to that physical address, or a null pointer if
@@ -13,6 +13,7 @@
 #include "filesys/directory.h"
 #include "filesys/file.h"
 #include "filesys/filesys.h"
+#include "filesys/inode.h"
 #include "threads/flags.h"
 #include "threads/init.h"
 #include "threads/interrupt.h"
@@ -20,13 +21,54 @@
 #include "threads/thread.h"
 #include "threads/vaddr.h"
 #include "threads/malloc.h"
+#include "threads/slab.h"
 #include "threads/synch.h"
 
 static thread_func start_process NO_RETURN;
-bool load (const char *cmdline, void (**eip) (void), void **esp);
+static thread_func start_fork NO_RETURN;
+static bool duplicate_files (struct thread *parent);
+bool load (char *cmd_line, struct file *, void (**eip) (void), void **esp);
+static struct file *open_executable (const char *name);
 void destroy_all_files(void);
 int process_status_wait_for_child_to_die(tid_t child_tid);
 
+/* Cache of struct status. */
+static struct kmem_cache *status_cache;
+
+/* Hash table of every struct status, by tid, so that a parent can
+   find a child's status without searching its child_processes.
+   Tids are handed out in order, so TID % STATUS_BUCKETS spreads
+   them evenly over the buckets. */
+#define STATUS_BUCKETS 64
+static struct list status_buckets[STATUS_BUCKETS];
+static struct lock status_lock;
+
+/* Protects the executable cache. */
+static struct lock image_lock;
+
+/* Initializes the process module.  Must be called before the
+   first thread is created, because every thread gets a status
+   block. */
+void
+process_init (void)
+{
+  int i;
+
+  status_cache = kmem_cache_create ("status", sizeof (struct status), NULL);
+  for (i = 0; i < STATUS_BUCKETS; i++)
+    list_init (&status_buckets[i]);
+  lock_init (&status_lock);
+  lock_init (&image_lock);
+}
+
+/* Hand-off from process_execute() to the child's start_process().
+   Fills one page, which the child frees once it has loaded. */
+struct exec_info
+  {
+    struct file *file;          /* Executable, already open. */
+    char cmd_line[PGSIZE - sizeof (struct file *)]; /* Command line. */
+  };
+
 /* Starts a new thread running a user program loaded from
    FILENAME.  The new thread may be scheduled (and may even exit)
    before process_execute() returns.  Returns the new process's
@@ -34,58 +76,53 @@ int process_status_wait_for_child_to_die(tid_t child_tid);
 tid_t
 process_execute (const char *file_name)
 {
-      char *fn_copy;
-    char *fn_copy_ex;
-      tid_t tid;
+  struct exec_info *info;
+  char thread_name[sizeof thread_current ()->name];
+  char *name, save;
+  size_t len;
+  tid_t tid;
 
   /* Make a copy of FILE_NAME.
      Otherwise there's a race between the caller and load(). */
-    char *save_ptr;
- 
-    fn_copy = palloc_get_page (0);
-	if (fn_copy == NULL){return TID_ERROR;}
-    strlcpy (fn_copy, file_name, PGSIZE);
-    
-	fn_copy_ex = palloc_get_page(0);
-	if(fn_copy_ex == NULL){return TID_ERROR;}
-	
-    strlcpy (fn_copy_ex, file_name, PGSIZE); 
-
-	char* pname = strtok_r(fn_copy, " ", &save_ptr);
-
-      /* Create a new thread to execute FILE_NAME. */
-     
-    tid = thread_create (pname, PRI_DEFAULT, start_process, fn_copy_ex);
-
-    struct file *f = filesys_open(pname);
-    if (f){// return -1;}
-
-    file_deny_write(f);
-    palloc_free_page(fn_copy);
-      thread_current()->rox = f;
-    }   
-    if (tid == TID_ERROR){palloc_free_page (fn_copy_ex);}
-/* 
-     else{
-        sema_down(&inited);
-		struct thread *child = get_thread_with_tid(tid);
-		if(child == TID_ERROR){
-		thread_unblock(child);		
-		if(!child->success){ return -1;}
-		}
-		process_status_add_child();
-        //sema_up(&inited);
+  info = palloc_get_page (0);
+  if (info == NULL)
+    return TID_ERROR;
+  strlcpy (info->cmd_line, file_name, sizeof info->cmd_line);
+
+  /* Open the executable here, so that the child does not have to
+     look it up again, and so that we fail at once if there is
+     none.  The program name is the first word of the command
+     line, which we terminate temporarily. */
+  name = info->cmd_line + strspn (info->cmd_line, " ");
+  len = strcspn (name, " ");
+  save = name[len];
+  name[len] = '\0';
+  info->file = open_executable (name);
+  strlcpy (thread_name, name, sizeof thread_name);
+  name[len] = save;
+  if (info->file == NULL) 
+    {
+      palloc_free_page (info);
+      return TID_ERROR;
     }
-*/
-    return tid;
+  file_deny_write (info->file);
+
+  /* Create a new thread to execute FILE_NAME. */
+  tid = thread_create (thread_name, PRI_DEFAULT, start_process, info);
+  if (tid == TID_ERROR)
+    {
+      file_close (info->file);
+      palloc_free_page (info); 
+    }
+  return tid;
 }
 
 /* A thread function that loads a user process and starts it
    running. */
 static void
-start_process (void *file_name_)
+start_process (void *info_)
 {
-      char *file_name = file_name_;
+      struct exec_info *info = info_;
       struct intr_frame if_;
       bool success;
  
@@ -94,10 +131,10 @@ start_process (void *file_name_)
       if_.gs = if_.fs = if_.es = if_.ds = if_.ss = SEL_UDSEG;
       if_.cs = SEL_UCSEG;
       if_.eflags = FLAG_IF | FLAG_MBS;
-      success = load (file_name, &if_.eip, &if_.esp);
+      success = load (info->cmd_line, info->file, &if_.eip, &if_.esp);
     
      /* If load failed, quit. */
-      palloc_free_page (file_name);
+      palloc_free_page (info);
   	struct thread * cur = thread_current();
 	if(success){
 		cur->process_status->loaded = 1;
@@ -133,6 +170,126 @@ start_process (void *file_name_)
       NOT_REACHED ();
 }
 
+/* Hand-off from process_fork() to the child's start_fork(). */
+struct fork_info
+  {
+    struct intr_frame if_;      /* Parent's user context. */
+    struct thread *parent;      /* Forking thread. */
+    struct semaphore done;      /* Upped when the child is set up. */
+    bool success;               /* Did the child set up correctly? */
+  };
+
+/* Creates a child process that is a copy of the running one,
+   resuming from user context F.  The child's address space
+   shares every page with the parent copy-on-write, and the child
+   gets its own duplicate of each open file descriptor.  Returns
+   the child's thread id, or TID_ERROR if the child cannot be
+   created.  The child sees a return value of 0. */
+tid_t
+process_fork (const struct intr_frame *f)
+{
+  struct thread *cur = thread_current ();
+  struct fork_info fi;
+  tid_t tid;
+
+  fi.if_ = *f;
+  fi.parent = cur;
+  fi.success = false;
+  sema_init (&fi.done, 0);
+
+  tid = thread_create (cur->name, PRI_DEFAULT, start_fork, &fi);
+  if (tid == TID_ERROR)
+    return TID_ERROR;
+
+  /* FI lives on our stack, so wait until the child is done with
+     it.  This also keeps our address space and descriptors still
+     while the child copies them. */
+  sema_down (&fi.done);
+  if (!fi.success) 
+    {
+      process_wait (tid);
+      return TID_ERROR;
+    }
+  return tid;
+}
+
+/* A thread function that finishes creating a forked process and
+   returns to user mode where its parent left off. */
+static void
+start_fork (void *fi_)
+{
+  struct fork_info *fi = fi_;
+  struct thread *cur = thread_current ();
+  struct intr_frame if_ = fi->if_;
+  bool success;
+
+  cur->pagedir = pagedir_fork (fi->parent->pagedir);
+  success = cur->pagedir != NULL && duplicate_files (fi->parent);
+  if (cur->pagedir != NULL)
+    process_activate ();
+
+  cur->process_status->loaded = success ? 1 : 2;
+  fi->success = success;
+  sema_up (&fi->done);
+  if (!success)
+    thread_exit ();
+
+  /* fork() returns 0 in the child. */
+  if_.eax = 0;
+  asm volatile ("movl %0, %%esp; jmp intr_exit" : : "g" (&if_) : "memory");
+  NOT_REACHED ();
+}
+
+/* Gives the running thread a duplicate of each of PARENT's open
+   file descriptors, under the same handles and at the same
+   positions.  Returns false if memory runs out. */
+static bool
+duplicate_files (struct thread *parent)
+{
+  struct thread *cur = thread_current ();
+  int handle;
+
+  for (handle = 0; handle < parent->fd_cnt; handle++)
+    {
+      struct fd_elem *pfd = parent->fds[handle];
+      struct fd_elem *fd;
+
+      if (pfd == NULL)
+        continue;
+      fd = kmem_cache_alloc (fd_elem_cache);
+      if (fd == NULL)
+        return false;
+
+      fd->is_dir = pfd->is_dir;
+      fd->file = NULL;
+      fd->dir = NULL;
+      if (pfd->is_dir)
+        fd->dir = dir_dup (pfd->dir);
+      else 
+        {
+          fd->file = file_reopen (pfd->file);
+          if (fd->file != NULL)
+            file_seek (fd->file, file_tell (pfd->file));
+        }
+      if (fd->file == NULL && fd->dir == NULL) 
+        {
+          kmem_cache_free (fd_elem_cache, fd);
+          return false;
+        }
+      if (install_fd (cur, fd, handle) < 0) 
+        {
+          if (fd->is_dir)
+            dir_close (fd->dir);
+          else
+            file_close (fd->file);
+          kmem_cache_free (fd_elem_cache, fd);
+          return false;
+        }
+    }
+  cur->fd_free = parent->fd_free;
+  return true;
+}
+
 /* Waits for thread TID to die and returns its exit status.  If
    it was terminated by the kernel (i.e. killed due to an
    exception), returns -1.  If TID is invalid or if it was not a
@@ -303,28 +460,255 @@ static bool load_segment (struct file *file, off_t ofs, uint8_t *upage,
                           uint32_t read_bytes, uint32_t zero_bytes,
                           bool writable);
 
-/* Loads an ELF executable from FILE_NAME into the current thread.
+/* Executable cache.
+
+   Running a program that was run recently skips both looking up
+   its name and reading its ELF headers.  Each entry is for one
+   executable, identified by its inode sector, and holds the
+   name it was last run under along with the directory the name
+   was relative to, and its parsed headers.
+
+   Headers are read and cached only while writes to the file are
+   denied, and an entry's headers are dropped as soon as writes to
+   its inode are allowed again, rather than on each write.  All
+   names are dropped whenever any file is removed, since that can
+   change what a name refers to, and an entry's sector may then be
+   reused for a different file. */
+
+#define IMAGE_CNT 8             /* Number of entries. */
+#define IMAGE_NAME_MAX 31       /* Longest name worth remembering. */
+
+/* A cached executable. */
+struct image 
+  {
+    block_sector_t sector;      /* Executable's inode sector. */
+    bool in_use;                /* Is this entry in use? */
+
+    /* Name lookup. */
+    bool has_name;              /* Are DIR and NAME valid? */
+    block_sector_t dir;         /* Directory NAME is relative to. */
+    char name[IMAGE_NAME_MAX + 1]; /* Name the executable was run as. */
+
+    /* Headers. */
+    struct Elf32_Phdr *phdrs;   /* Program headers, or null if unknown. */
+    struct Elf32_Ehdr ehdr;     /* Executable header. */
+  };
+
+static struct image images[IMAGE_CNT];
+static int image_hand;          /* Next entry to replace. */
+static unsigned image_removals; /* Number of files removed. */
+
+/* Returns the entry for SECTOR, or a null pointer if there is
+   none.  If CREATE is true, makes an entry if there is none,
+   replacing an old one if necessary.  Must be called with
+   image_lock held. */
+static struct image *
+image_lookup (block_sector_t sector, bool create) 
+{
+  struct image *im;
+  int i;
+
+  for (i = 0; i < IMAGE_CNT; i++)
+    if (images[i].in_use && images[i].sector == sector)
+      return &images[i];
+  if (!create)
+    return NULL;
+
+  im = &images[image_hand];
+  image_hand = (image_hand + 1) % IMAGE_CNT;
+  free (im->phdrs);
+  im->phdrs = NULL;
+  im->sector = sector;
+  im->in_use = true;
+  im->has_name = false;
+  return im;
+}
+
+/* Returns the sector of the directory that NAME is relative to. */
+static block_sector_t
+name_dir (const char *name) 
+{
+  struct dir *cwd = thread_current ()->current_working_dir;
+
+  if (name[0] == '/' || cwd == NULL)
+    return ROOT_DIR_SECTOR;
+  return inode_get_inumber (dir_get_inode (cwd));
+}
+
+/* Opens and returns the executable file NAME, or returns a null
+   pointer if there is no such file or it is a directory. */
+static struct file *
+open_executable (const char *name) 
+{
+  block_sector_t dir = name_dir (name);
+  struct file *file = NULL;
+  struct inode *inode;
+  unsigned removals;
+  int i;
+
+  /* Look for the name in the cache.  Open the inode before
+     letting go of the lock, so that the file cannot be removed
+     in between. */
+  lock_acquire (&image_lock);
+  for (i = 0; i < IMAGE_CNT; i++) 
+    {
+      struct image *im = &images[i];
+      if (im->in_use && im->has_name && im->dir == dir
+          && !strcmp (im->name, name)) 
+        {
+          file = file_open (inode_open (im->sector));
+          break;
+        }
+    }
+  removals = image_removals;
+  lock_release (&image_lock);
+  if (file != NULL)
+    return file;
+
+  /* Look it up the slow way. */
+  file = filesys_open (name);
+  if (file == NULL)
+    return NULL;
+  inode = file_get_inode (file);
+  if (is_inode_directory (inode)) 
+    {
+      dir_close ((struct dir *) file);
+      return NULL;
+    }
+
+  /* Remember the name, unless a file was removed while we were
+     looking it up, in which case it might already be stale. */
+  if (strlen (name) <= IMAGE_NAME_MAX) 
+    {
+      lock_acquire (&image_lock);
+      if (removals == image_removals) 
+        {
+          struct image *im = image_lookup (inode_get_inumber (inode), true);
+          im->has_name = true;
+          im->dir = dir;
+          strlcpy (im->name, name, sizeof im->name);
+        }
+      lock_release (&image_lock);
+    }
+  return file;
+}
+
+/* Reads FILE's executable header into *EHDR and checks it, then
+   reads its program headers.  Uses the cache if it can.  Returns
+   the program headers in a block that the caller must free(), or
+   a null pointer on failure. */
+static struct Elf32_Phdr *
+get_headers (struct file *file, struct Elf32_Ehdr *ehdr) 
+{
+  block_sector_t sector = inode_get_inumber (file_get_inode (file));
+  struct Elf32_Phdr *phdrs = NULL;
+  struct image *im;
+  unsigned removals;
+  size_t size;
+
+  /* Try the cache. */
+  lock_acquire (&image_lock);
+  removals = image_removals;
+  im = image_lookup (sector, false);
+  if (im != NULL && im->phdrs != NULL) 
+    {
+      *ehdr = im->ehdr;
+      size = ehdr->e_phnum * sizeof *phdrs;
+      phdrs = malloc (size);
+      if (phdrs != NULL)
+        memcpy (phdrs, im->phdrs, size);
+    }
+  lock_release (&image_lock);
+  if (phdrs != NULL)
+    return phdrs;
+
+  /* Read and verify executable header. */
+  if (file_read_at (file, ehdr, sizeof *ehdr, 0) != sizeof *ehdr
+      || memcmp (ehdr->e_ident, "\177ELF\1\1\1", 7)
+      || ehdr->e_type != 2
+      || ehdr->e_machine != 3
+      || ehdr->e_version != 1
+      || ehdr->e_phentsize != sizeof (struct Elf32_Phdr)
+      || ehdr->e_phnum > 1024)
+    return NULL;
+
+  /* Read program headers, all at once.  Always allocate at least
+     one, so that a null pointer only means failure. */
+  size = ehdr->e_phnum * sizeof *phdrs;
+  if (ehdr->e_phoff > (Elf32_Off) file_length (file))
+    return NULL;
+  phdrs = malloc (size > 0 ? size : sizeof *phdrs);
+  if (phdrs == NULL)
+    return NULL;
+  if (file_read_at (file, phdrs, size, ehdr->e_phoff) != (off_t) size) 
+    {
+      free (phdrs);
+      return NULL;
+    }
+
+  /* Remember them.  Writes to FILE are denied, so they cannot
+     have gone stale, unless FILE was removed.  Running out of
+     memory here is harmless. */
+  lock_acquire (&image_lock);
+  im = removals == image_removals ? image_lookup (sector, true) : NULL;
+  if (im != NULL && im->phdrs == NULL) 
+    {
+      im->phdrs = malloc (size > 0 ? size : sizeof *phdrs);
+      if (im->phdrs != NULL) 
+        {
+          memcpy (im->phdrs, phdrs, size);
+          im->ehdr = *ehdr;
+        }
+    }
+  lock_release (&image_lock);
+  return phdrs;
+}
+
+/* Tells the executable cache that the file whose inode is in
+   SECTOR may now be written to or, if REMOVED is true, has been
+   removed. */
+void
+process_image_changed (block_sector_t sector, bool removed) 
+{
+  int i;
+
+  lock_acquire (&image_lock);
+  if (removed)
+    image_removals++;
+  for (i = 0; i < IMAGE_CNT; i++) 
+    {
+      struct image *im = &images[i];
+      if (!im->in_use)
+        continue;
+      if (im->sector == sector) 
+        {
+          free (im->phdrs);
+          im->phdrs = NULL;
+          if (removed)
+            im->in_use = false;
+        }
+      if (removed)
+        im->has_name = false;
+    }
+  lock_release (&image_lock);
+}
+
+/* Loads the ELF executable FILE, which was run with command line
+   CMD_LINE, into the current thread.  The current thread takes
+   over FILE if loading succeeds, and closes it if not.
    Stores the executable's entry point into *EIP
    and its initial stack pointer into *ESP.
    Returns true if successful, false otherwise. */
 bool
-load (const char *file_name, void (**eip) (void), void **esp)
+load (char *cmd_line, struct file *file, void (**eip) (void), void **esp)
 {
  
   struct thread *t = thread_current ();
   struct Elf32_Ehdr ehdr;
-  struct file *file = NULL;
-  off_t file_ofs;
+  struct Elf32_Phdr *phdrs = NULL;
   bool success = false;
   int i;
-    char* copy_fn;
-    copy_fn = palloc_get_page (0);
-      if (copy_fn == NULL){return TID_ERROR;}
     char *save_ptr;
-    strlcpy (copy_fn, file_name, PGSIZE);
-   
-      file_name = strtok_r(file_name, " ", &save_ptr);
-
 
   /* Allocate and activate page directory. */
   t->pagedir = pagedir_create ();
@@ -332,40 +716,16 @@ load (const char *file_name, void (**eip) (void), void **esp)
     goto done;
   process_activate ();
 
-  /* Open executable file. */
-  file = filesys_open (file_name);
-  if (file == NULL)
-    {
-      goto done;
-    }
-
-   // file_deny_write(file);
-   
-  /* Read and verify executable header. */
-  if (file_read (file, &ehdr, sizeof ehdr) != sizeof ehdr
-      || memcmp (ehdr.e_ident, "\177ELF\1\1\1", 7)
-      || ehdr.e_type != 2
-      || ehdr.e_machine != 3
-      || ehdr.e_version != 1
-      || ehdr.e_phentsize != sizeof (struct Elf32_Phdr)
-      || ehdr.e_phnum > 1024)
-    {
-      goto done;
-    }
+  /* Get executable header and program headers. */
+  phdrs = get_headers (file, &ehdr);
+  if (phdrs == NULL)
+    goto done;
 
-  /* Read program headers. */
-  file_ofs = ehdr.e_phoff;
+  /* Load segments. */
   for (i = 0; i < ehdr.e_phnum; i++)
     {
-      struct Elf32_Phdr phdr;
+      struct Elf32_Phdr phdr = phdrs[i];
 
-      if (file_ofs < 0 || file_ofs > file_length (file))
-        goto done;
-      file_seek (file, file_ofs);
-
-      if (file_read (file, &phdr, sizeof phdr) != sizeof phdr)
-        goto done;
-      file_ofs += sizeof phdr;
       switch (phdr.p_type)
         {
         case PT_NULL:
@@ -424,7 +784,7 @@ load (const char *file_name, void (**eip) (void), void **esp)
    
   char *token;
  // char *save_ptr;
-  argv[0] = strtok_r(copy_fn, " ", &save_ptr);
+  argv[0] = strtok_r(cmd_line, " ", &save_ptr);
   int argc = 1; //firstcmd
  
   /*int counter = 0;*/
@@ -502,7 +862,11 @@ int filler = counter_letter%4;
 
  done:
  /* We arrive here whether the load is successful or not. */
-  file_close (file);
+  free (phdrs);
+  if (success)
+    t->rox = file;
+  else
+    file_close (file);
   return success;
 }
 
@@ -587,6 +951,21 @@ load_segment (struct file *file, off_t ofs, uint8_t *upage,
       size_t page_read_bytes = read_bytes < PGSIZE ? read_bytes : PGSIZE;
       size_t page_zero_bytes = PGSIZE - page_read_bytes;
 
+      /* A page with nothing to read (e.g. in .bss) starts out as
+         the shared zero page.  It gets a frame of its own only
+         when it is first written. */
+      if (page_read_bytes == 0)
+        {
+          struct thread *t = thread_current ();
+          if (pagedir_get_page (t->pagedir, upage) != NULL
+              || !pagedir_set_zero_page (t->pagedir, upage, writable))
+            return false;
+
+          zero_bytes -= page_zero_bytes;
+          upage += PGSIZE;
+          continue;
+        }
+
       /* Get a page of memory. */
       uint8_t *kpage = palloc_get_page (PAL_USER);
       if (kpage == NULL)
@@ -729,33 +1108,46 @@ void process_status_kill_the_children(void){
 }
 */
 struct status* give_birth(tid_t tid){
-	struct status * child = malloc(sizeof(struct status));
+	struct status * child = kmem_cache_alloc(status_cache);
 	if(!child){return NULL;}
 	child->tid = tid;
+	child->parent = thread_current()->tid;
 	child->loaded = 0;
 	child->waiting = false;
 	child->died = false;
 	sema_init(&child->load, 0);
 	sema_init(&child->dead, 0);
 	list_push_back(&thread_current()->child_processes, &child->elem);
+	lock_acquire(&status_lock);
+	list_push_back(&status_buckets[(unsigned) tid % STATUS_BUCKETS], &child->tid_elem);
+	lock_release(&status_lock);
 	return child;
 }
 
+/* Returns the status of the running thread's child TID, or a null
+   pointer if it has no such child. */
 struct status* get_child(tid_t tid){
-	struct thread * t = thread_current();
+	struct list *bucket = &status_buckets[(unsigned) tid % STATUS_BUCKETS];
+	struct status *found = NULL;
 	struct list_elem * i;
-	for (i = list_begin(&t->child_processes); i != list_end(&t->child_processes); i = list_next(i)){
-		struct status *cps = list_entry(i, struct status, elem);
+	lock_acquire(&status_lock);
+	for (i = list_begin(bucket); i != list_end(bucket); i = list_next(i)){
+		struct status *cps = list_entry(i, struct status, tid_elem);
 		if(cps->tid == tid){
-			return cps;
+			if(cps->parent == thread_current()->tid){found = cps;}
+			break;
 		}
 	}
-	return NULL;
+	lock_release(&status_lock);
+	return found;
 }
 
 void kill_child(struct status * child){
 	list_remove(&child->elem);
-	free(child);
+	lock_acquire(&status_lock);
+	list_remove(&child->tid_elem);
+	lock_release(&status_lock);
+	kmem_cache_free(status_cache, child);
 }
 
 void  kill_all_the_children(void){
@@ -772,15 +1164,14 @@ void  kill_all_the_children(void){
 
 void destroy_all_files(void){
 	struct thread * cur = thread_current();
-	struct list_elem *i = list_begin(&cur->file_lists);
-	struct list_elem *next_file = i;
-	while(i != list_end(&cur->file_lists)){
-		next_file = list_next(i);
-		struct fd_elem *fd = list_entry(i, struct fd_elem, elem);
+	for(int i = 0; i < cur->fd_cnt; i++){
+		struct fd_elem *fd = cur->fds[i];
+		if(fd == NULL){continue;}
 		if(fd->is_dir){dir_close(fd->dir);}
 		else{file_close(fd->file);}
-		list_remove(&fd->elem);
-		free(fd);
-		i=next_file;
+		kmem_cache_free(fd_elem_cache, fd);
 	}
+	free(cur->fds);
+	cur->fds = NULL;
+	cur->fd_cnt = 0;
 } 
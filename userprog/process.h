@@ -2,11 +2,17 @@
 #define USERPROG_PROCESS_H
 
 #include "threads/thread.h"
+#include "devices/block.h"
 
+struct intr_frame;
+
+void process_init (void);
 tid_t process_execute (const char *file_name);
+tid_t process_fork (const struct intr_frame *);
 int process_wait (tid_t);
 void process_exit (void);
 void process_activate (void);
+void process_image_changed (block_sector_t, bool removed);
 struct status* give_birth(tid_t tid);
 struct status* get_child(tid_t tid);
 void kill_child(struct status* child);
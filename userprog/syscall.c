@@ -7,6 +7,7 @@
 #include <string.h>
 #include "userprog/pagedir.h"
 #include "userprog/process.h"
+#include "userprog/uaccess.h"
 #include "filesys/file.h"
 #include "filesys/filesys.h"
 #include "filesys/inode.h"
@@ -17,13 +18,23 @@
 #include "threads/synch.h"
 #include "threads/malloc.h"
 #include "threads/palloc.h"
+#include "threads/slab.h"
 #include "threads/vaddr.h"
+#include "devices/timer.h"
+#include <inttypes.h>
+#include <limits.h>
 #include <stdlib.h>
 
 void check_arg(struct intr_frame *f, int *args, int paremc);
-static bool is_user(const void* vaddr);
 static struct fd_elem* find_file(int number);
 static void syscall_handler (struct intr_frame *);
+
+/* Vector number that sysenter_entry in threads/intr-stubs.S
+   gives to system calls made with SYSENTER. */
+#define SYSENTER_VEC 0x31
+
+/* Cache of struct fd_elem, shared with process.c. */
+struct kmem_cache *fd_elem_cache;
 char * string_to_page(const char * string);
 
 void halt (void);
@@ -39,249 +50,286 @@ int write(int fd, const void *buffer, unsigned size);
 void seek (int fd, unsigned position);
 unsigned tell (int fd);
 void close (int fd);
-void valid_kernel(const void *check_valid);
+int pread (int fd, void *buffer, unsigned size, int offset);
+int pwrite (int fd, const void *buffer, unsigned size, int offset);
+
+/* Scatter/gather I/O.  Must match lib/user/syscall.h. */
+struct iovec 
+  {
+    void *iov_base;             /* User buffer. */
+    size_t iov_len;             /* Its size in bytes. */
+  };
+#define IOV_MAX 1024            /* Most iovecs in one call. */
+#define IOV_BATCH 16            /* Iovecs to copy in at once. */
+int readv (int fd, const struct iovec *iov, int iovcnt);
+int writev (int fd, const struct iovec *iov, int iovcnt);
+int copy_file_range (int in_fd, int out_fd, unsigned length);
+static int read_to_user (struct fd_elem *, uint8_t *, unsigned size, off_t,
+                         uint8_t *page);
+static int write_from_user (struct fd_elem *, const uint8_t *, unsigned size,
+                            off_t, uint8_t *page);
+static int transfer_iov (int fd, const struct iovec *, int iovcnt, bool write);
 
 /* Directory Support */
 bool chdir(const char *dir);
 bool mkdir(const char *dir);
 bool readdir(int fd, char *name);
+int getdents(int fd, struct dir_record *buffer, unsigned size);
+
+/* File status.  Must match lib/user/syscall.h. */
+struct stat 
+  {
+    int size;                   /* Length in bytes. */
+    int inumber;                /* Inode number. */
+    bool is_dir;                /* Is it a directory? */
+    int open_cnt;               /* Number of times it is open. */
+  };
+bool stat(const char *file, struct stat *st);
+bool fstat(int fd, struct stat *st);
 bool isdir(int fd);
 int inumber(int fd);
 
 int add_file(struct file * f);
 int add_dir(struct dir * d);
 
-static bool is_user(const void* vaddr){
-    if(vaddr == NULL) return false;
-    
-    // User address not initalized
-    return (
-        vaddr < PHYS_BASE 
-        && pagedir_get_page(thread_current()->pagedir, vaddr) 
-        != NULL
-    );
-}
-
-/*
-Implement code to read the system call number from the user stack and 
-dispatch to a handler based on it.
-*/
+/* System call dispatch.
+
+   Each system call has an entry in syscall_table, indexed by its
+   SYS_* number, that says how many arguments it takes and what
+   they are, and names a wrapper that passes them on to the
+   function that does the work.  syscall_handler() fetches and
+   checks the arguments according to the entry before calling the
+   wrapper, so the wrappers see only kernel copies of strings and
+   buffers that lie in user memory. */
+
+/* Kinds of system call argument. */
+enum arg_type
+  {
+    ARG_INT,                    /* Plain value. */
+    ARG_STR,                    /* User string, passed as a kernel copy. */
+    ARG_BUF,                    /* User buffer, next argument is its size. */
+    ARG_NAME,                   /* User buffer of NAME_MAX + 1 bytes. */
+    ARG_IOV,                    /* User iovec array, next argument is count. */
+    ARG_STAT                    /* User struct stat, filled in on success. */
+  };
+
+/* Most arguments a system call takes. */
+#define MAX_ARGS 4
+
+/* Calls a system call's implementation with ARGS and returns its
+   return value. */
+typedef int syscall_func (struct intr_frame *, int args[MAX_ARGS]);
+
+/* A system call. */
+struct syscall 
+  {
+    const char *name;                   /* Name, for statistics. */
+    syscall_func *func;                 /* Implementation. */
+    int arg_cnt;                        /* Number of arguments. */
+    enum arg_type arg_types[MAX_ARGS];  /* Types of arguments. */
+
+    /* Statistics. */
+    unsigned long long call_cnt;        /* Number of calls. */
+    int64_t ticks;                      /* Timer ticks spent in calls. */
+  };
+
+static void free_strings (const struct syscall *, int args[], int cnt);
+
+static syscall_func sys_halt, sys_exit, sys_exec, sys_wait, sys_create,
+  sys_remove, sys_open, sys_filesize, sys_read, sys_write, sys_seek,
+  sys_tell, sys_close, sys_chdir, sys_mkdir, sys_readdir, sys_isdir,
+  sys_inumber, sys_fork, sys_pread, sys_pwrite, sys_readv, sys_writev,
+  sys_copy_file_range, sys_getdents, sys_stat, sys_fstat;
+
+/* System calls, indexed by number.  Null entries are
+   unimplemented. */
+static struct syscall syscall_table[] = 
+  {
+    [SYS_HALT] = {"halt", sys_halt, 0, {}},
+    [SYS_EXIT] = {"exit", sys_exit, 1, {ARG_INT}},
+    [SYS_EXEC] = {"exec", sys_exec, 1, {ARG_STR}},
+    [SYS_WAIT] = {"wait", sys_wait, 1, {ARG_INT}},
+    [SYS_CREATE] = {"create", sys_create, 2, {ARG_STR, ARG_INT}},
+    [SYS_REMOVE] = {"remove", sys_remove, 1, {ARG_STR}},
+    [SYS_OPEN] = {"open", sys_open, 1, {ARG_STR}},
+    [SYS_FILESIZE] = {"filesize", sys_filesize, 1, {ARG_INT}},
+    [SYS_READ] = {"read", sys_read, 3, {ARG_INT, ARG_BUF, ARG_INT}},
+    [SYS_WRITE] = {"write", sys_write, 3, {ARG_INT, ARG_BUF, ARG_INT}},
+    [SYS_SEEK] = {"seek", sys_seek, 2, {ARG_INT, ARG_INT}},
+    [SYS_TELL] = {"tell", sys_tell, 1, {ARG_INT}},
+    [SYS_CLOSE] = {"close", sys_close, 1, {ARG_INT}},
+    [SYS_CHDIR] = {"chdir", sys_chdir, 1, {ARG_STR}},
+    [SYS_MKDIR] = {"mkdir", sys_mkdir, 1, {ARG_STR}},
+    [SYS_READDIR] = {"readdir", sys_readdir, 2, {ARG_INT, ARG_NAME}},
+    [SYS_ISDIR] = {"isdir", sys_isdir, 1, {ARG_INT}},
+    [SYS_INUMBER] = {"inumber", sys_inumber, 1, {ARG_INT}},
+    [SYS_FORK] = {"fork", sys_fork, 0, {}},
+    [SYS_PREAD] = {"pread", sys_pread, 4, {ARG_INT, ARG_BUF, ARG_INT, ARG_INT}},
+    [SYS_PWRITE] = {"pwrite", sys_pwrite, 4,
+                    {ARG_INT, ARG_BUF, ARG_INT, ARG_INT}},
+    [SYS_READV] = {"readv", sys_readv, 3, {ARG_INT, ARG_IOV, ARG_INT}},
+    [SYS_WRITEV] = {"writev", sys_writev, 3, {ARG_INT, ARG_IOV, ARG_INT}},
+    [SYS_COPY_FILE_RANGE] = {"copy_file_range", sys_copy_file_range, 3,
+                             {ARG_INT, ARG_INT, ARG_INT}},
+    [SYS_GETDENTS] = {"getdents", sys_getdents, 3, {ARG_INT, ARG_BUF, ARG_INT}},
+    [SYS_STAT] = {"stat", sys_stat, 2, {ARG_STR, ARG_STAT}},
+    [SYS_FSTAT] = {"fstat", sys_fstat, 2, {ARG_INT, ARG_STAT}},
+  };
+
+/* Number of entries in syscall_table. */
+#define SYSCALL_CNT ((int) (sizeof syscall_table / sizeof *syscall_table))
 
 void
 syscall_init (void)
 {
   //lock_init(&locker);
+  fd_elem_cache = kmem_cache_create ("fd_elem", sizeof (struct fd_elem), NULL);
   intr_register_int (0x30, 3, INTR_ON, syscall_handler, "syscall");
+  intr_register_int (SYSENTER_VEC, 0, INTR_ON, syscall_handler, "sysenter");
 }
 
 static void
-syscall_handler (struct intr_frame *f UNUSED)
+syscall_handler (struct intr_frame *f)
 {
-   
-    /* Check if esp is valid */
-    const void *check_valid = (const void*)f->esp;
-//    if 
-	//(!
-	valid_kernel(check_valid); //{exit(-1);}
-   
-  int call = * (int *)f->esp;
-  int args[3]; // 3 maxargs
-   
-    // Retreive Arguments
-   
-   
-  switch(call) {
-    /* Halt the operating system. */
-    case SYS_HALT:
-      {
-          halt();
-        break;
-      }
-     
-    /* Terminate this process. */
-    case SYS_EXIT:                 
-      {
-          check_arg(f, &args[0], 1);
-   // valid_kernel((const void*)args[0]);
-        
-		    exit((int)args[0]);
-        break;
-      }
-     
-    /* Start another process. */
-    case SYS_EXEC:                 
-      {
-        check_arg(f, &args[0], 1);
-   //   valid_kernel((const void*)args[0]);
-        f->eax = exec((const char*)args[0]);
-        break;
-      }
-     
-    /* Wait for a child process to die. */
-    case SYS_WAIT:                 
-      {
-    check_arg(f,&args[0], 1);
-    f->eax = wait((tid_t)args[0]);
-        break;
-      }
-     
-    /* Create a file. */
-    case SYS_CREATE:              
-      {
-        check_arg(f, &args[0],2);
-      valid_kernel((const void*)args[0]);
-          f->eax = create((const char *)args[0], (unsigned)args[1]);
+  struct syscall *sc;
+  int args[MAX_ARGS];
+  struct stat st;
+  struct stat *user_st = NULL;
+  int64_t start;
+  int call;
+  int i;
+
+  /* Fetch the system call number, which is in eax for sysenter
+     and on the stack for int $0x30, which also checks esp. */
+  if(f->vec_no == SYSENTER_VEC){call = f->eax;}
+  else if(!copy_from_user(&call, f->esp, sizeof call)){exit(-1);}
+  if(call < 0 || call >= SYSCALL_CNT || syscall_table[call].func == NULL){
+    exit(-1);
+  }
+  sc = &syscall_table[call];
+
+  /* Fetch and check the arguments.  Strings are copied in only
+     after everything else has been checked, so that a bad
+     argument cannot leave a string page behind. */
+  check_arg(f, args, sc->arg_cnt);
+  for(i = 0; i < sc->arg_cnt; i++){
+    switch(sc->arg_types[i]){
+      case ARG_INT:
+      case ARG_STR:
         break;
-      }
-     
-    /* Delete a file. */
-    case SYS_REMOVE:              
-      {
-          check_arg(f, &args[0], 1);
-      valid_kernel((const void*)args[0]);
-        f->eax = remove((const char *)args[0]);
+      case ARG_BUF:
+        if(!is_user_range((void *) args[i], (unsigned) args[i + 1])){exit(-1);}
         break;
-      }
-     
-    /* Open a file. */
-    case SYS_OPEN:                 
-      {
-        check_arg(f,&args[0],1);
-      valid_kernel((const void*)args[0]);
-        f->eax = open((const char *)args[0]);
+      case ARG_NAME:
+        if(!is_user_range((void *) args[i], NAME_MAX + 1)){exit(-1);}
         break;
-      }
-     
-    /* Obtain a file's size. */
-    case SYS_FILESIZE:             
-      {
-          check_arg(f,&args[0], 1);
-          f->eax = filesize((int)args[0]);
+      case ARG_IOV:
+        /* A bad count is an error, returned by the call. */
+        if((unsigned) args[i + 1] <= IOV_MAX
+           && !is_user_range((void *) args[i],
+                             args[i + 1] * sizeof (struct iovec))){exit(-1);}
         break;
-      }
-     
-    /* Read from a file. */
-    case SYS_READ:                 
-      {
-          check_arg(f, &args[0], 3);
-      valid_kernel((const void*)args[1]);
-          f->eax = read((int) args[0], (void *)args[1], (unsigned) args[2]);
-        break;
-      }
-     
-    /* Write to a file. */
-    case SYS_WRITE:                
-      {
-        check_arg(f,&args[0],3);
-      valid_kernel((const void*)args[1]);
-        f->eax = write((int)args[0],(void *)args[1], (unsigned) args[2]);
-		break;
-      }
-     
-    /* Change position in a file. */
-    case SYS_SEEK:                 
-      {
-          check_arg(f,&args[0], 2);
-          seek((int) args[0], (unsigned)args[1]);
+      case ARG_STAT:
+        /* The call fills in st, which is copied out below. */
+        if(!is_user_range((void *) args[i], sizeof (struct stat))){exit(-1);}
+        user_st = (struct stat *) args[i];
+        args[i] = (int) &st;
         break;
-      }
-     
-    /* Report current position in a file. */
-    case SYS_TELL:
-      {
-        check_arg(f,&args[0],1);
-        f->eax = tell((int)args[0]);
-        break;
-      }
-     
-    /* Close a file. */
-    case SYS_CLOSE:
-      {
-          check_arg(f,&args[0], 1);
-          close((int)args[0]);
-        break;
-      }
-    
-    /* Change directory */
-    case SYS_CHDIR:
-    {
-     
-      check_arg(f, &args[0],1);
-      valid_kernel((const void*) args[0]);
-      f->eax = chdir((const char *) args[0]);
-      
-      break;
-      
-    }
-     
-    /* Make directory */
-    case SYS_MKDIR:
-    {
-        
-      check_arg(f, &args[0], 1);
-      valid_kernel((const void*) args[0]);
-      f->eax = mkdir((const char *) args[0]);
-      
-      break;
-      
-    }
-    
-    /* Read/Open directory */
-    case SYS_READDIR:
-    {   
-        
-      check_arg(f, &args[0], 2);
-      valid_kernel((const void*) args[1]);
-      f->eax = readdir((int) args[0], (const char *) args[1]);
-      
-      break;
-    }
-                        
-    /* Verify directory */
-    case SYS_ISDIR:
-    {
-          
-      check_arg(f, &args[0], 1);
-      f->eax = isdir((int) args[0]);
-      
-      break;
-      
     }
-                        
-    /* Get inode index number */   
-    case SYS_INUMBER:
-    {
-      check_arg(f, &args[0], 1);
-      f->eax = inumber((int) args[0]);
-      
-      break;
-    }
-    default:
-    {
+  }
+  for(i = 0; i < sc->arg_cnt; i++){
+    if(sc->arg_types[i] == ARG_STR){
+      char *page = string_to_page((const char *) args[i]);
+      if(page == NULL){
+        free_strings(sc, args, i);
         exit(-1);
-     }
+      }
+      args[i] = (int) page;
+    }
+  }
+
+  /* Count the call first, since some calls do not return. */
+  sc->call_cnt++;
+  start = timer_ticks();
+  f->eax = sc->func(f, args);
+  sc->ticks += timer_elapsed(start);
+  free_strings(sc, args, sc->arg_cnt);
+
+  if(user_st != NULL && f->eax && !copy_to_user(user_st, &st, sizeof st)){
+    exit(-1);
   }
- 
-  // thread_exit ();
 }
+
+/* Frees the pages that syscall_handler() copied SC's string
+   arguments into, among the first CNT of ARGS. */
+static void
+free_strings (const struct syscall *sc, int args[], int cnt)
+{
+  int i;
+
+  for(i = 0; i < cnt; i++){
+    if(sc->arg_types[i] == ARG_STR){palloc_free_page((void *) args[i]);}
+  }
+}
+
+/* Prints system call statistics. */
+void
+syscall_print_stats (void)
+{
+  int i;
+
+  printf ("System calls:");
+  for (i = 0; i < SYSCALL_CNT; i++)
+    if (syscall_table[i].call_cnt > 0)
+      printf (" %s %llu (%"PRId64" ticks)", syscall_table[i].name,
+              syscall_table[i].call_cnt, syscall_table[i].ticks);
+  printf ("\n");
+}
+
+/* Wrappers for the system calls in syscall_table. */
+static int sys_halt (struct intr_frame *f UNUSED, int args[] UNUSED) {halt(); NOT_REACHED();}
+static int sys_exit (struct intr_frame *f UNUSED, int args[]) {exit(args[0]); NOT_REACHED();}
+static int sys_exec (struct intr_frame *f UNUSED, int args[]) {return exec((const char *) args[0]);}
+static int sys_wait (struct intr_frame *f UNUSED, int args[]) {return wait((tid_t) args[0]);}
+static int sys_create (struct intr_frame *f UNUSED, int args[]) {return create((const char *) args[0], (unsigned) args[1]);}
+static int sys_remove (struct intr_frame *f UNUSED, int args[]) {return remove((const char *) args[0]);}
+static int sys_open (struct intr_frame *f UNUSED, int args[]) {return open((const char *) args[0]);}
+static int sys_filesize (struct intr_frame *f UNUSED, int args[]) {return filesize(args[0]);}
+static int sys_read (struct intr_frame *f UNUSED, int args[]) {return read(args[0], (void *) args[1], (unsigned) args[2]);}
+static int sys_write (struct intr_frame *f UNUSED, int args[]) {return write(args[0], (const void *) args[1], (unsigned) args[2]);}
+static int sys_seek (struct intr_frame *f UNUSED, int args[]) {seek(args[0], (unsigned) args[1]); return 0;}
+static int sys_tell (struct intr_frame *f UNUSED, int args[]) {return tell(args[0]);}
+static int sys_close (struct intr_frame *f UNUSED, int args[]) {close(args[0]); return 0;}
+static int sys_chdir (struct intr_frame *f UNUSED, int args[]) {return chdir((const char *) args[0]);}
+static int sys_mkdir (struct intr_frame *f UNUSED, int args[]) {return mkdir((const char *) args[0]);}
+static int sys_readdir (struct intr_frame *f UNUSED, int args[]) {return readdir(args[0], (char *) args[1]);}
+static int sys_isdir (struct intr_frame *f UNUSED, int args[]) {return isdir(args[0]);}
+static int sys_inumber (struct intr_frame *f UNUSED, int args[]) {return inumber(args[0]);}
+static int sys_fork (struct intr_frame *f, int args[] UNUSED) {return process_fork(f);}
+static int sys_pread (struct intr_frame *f UNUSED, int args[]) {return pread(args[0], (void *) args[1], (unsigned) args[2], args[3]);}
+static int sys_pwrite (struct intr_frame *f UNUSED, int args[]) {return pwrite(args[0], (const void *) args[1], (unsigned) args[2], args[3]);}
+static int sys_readv (struct intr_frame *f UNUSED, int args[]) {return readv(args[0], (const struct iovec *) args[1], args[2]);}
+static int sys_writev (struct intr_frame *f UNUSED, int args[]) {return writev(args[0], (const struct iovec *) args[1], args[2]);}
+static int sys_copy_file_range (struct intr_frame *f UNUSED, int args[]) {return copy_file_range(args[0], args[1], (unsigned) args[2]);}
+static int sys_getdents (struct intr_frame *f UNUSED, int args[]) {return getdents(args[0], (struct dir_record *) args[1], (unsigned) args[2]);}
+static int sys_stat (struct intr_frame *f UNUSED, int args[]) {return stat((const char *) args[0], (struct stat *) args[1]);}
+static int sys_fstat (struct intr_frame *f UNUSED, int args[]) {return fstat(args[0], (struct stat *) args[1]);}
+
+/* Copies the PAREMC arguments of the system call into ARGS.
+   After sysenter they are in ebx, esi, and edi.  After int $0x30
+   they are above the system call number on the user stack, and
+   the process is terminated if any of them is not in mapped user
+   memory. */
 void check_arg(struct intr_frame *f, int *args, int paremc){
-//    int ptr;
-//    ptr = * (int *) f->esp + 1;
-    int count = paremc;
-    while(count > -1){
-        if(!is_user(f->esp+count)){
-        exit(-1);
-        }
-        count --;
+    if(f->vec_no == SYSENTER_VEC){
+        args[0] = f->ebx;
+        args[1] = f->esi;
+        args[2] = f->edi;
+        args[3] = f->ebp;
+        return;
     }
-//    if(*ptr <SYS_HALT){
-//        exit(-1);
-//    }
-    for(int i =0; i < paremc ; i++){
-//        if(!is_user(*(int*)f->esp+i+1)){
-//        exit(-1);
-//        }
-        args[i]=*((int*) f->esp+1+i);
+    if(!copy_from_user(args, (int *) f->esp + 1, paremc * sizeof *args)){
+        exit(-1);
     }
 }
 
@@ -319,7 +367,6 @@ the child process successfully loaded its executable. You must use
 appropriate synchronization to ensure this. */
 tid_t exec (const char *cmd_line) {
 	if(!cmd_line){return -1;}
-	if(!is_user(cmd_line)){return -1;}
 	tid_t tid = process_execute(cmd_line);
 	struct status* child = get_child(tid);
 	if(!child){return -1;}
@@ -367,7 +414,6 @@ Creating a new file does not open it:
 opening the new file is a separate operation which would require a open system call. */
 bool create (const char *file, unsigned initial_size) {
     if(!file){return -1;}
-    if(!is_user(file)){return -1;} 
   return filesys_create(file, initial_size,false);
 }
 
@@ -376,7 +422,6 @@ A file may be removed regardless of whether it is open or closed,
 and removing an open file does not close it. See Removing an Open File, for details. */
 bool remove (const char *file) {
     if(!file){return -1;}
-    if(!is_user(file)){return -1;}
   return filesys_remove(file);
 }
 
@@ -400,8 +445,14 @@ int open (const char *file) {
     struct file *f = filesys_open(file);
     if(!f){return -1;}
     int handle;
-    if(is_inode_directory(file_get_inode(f))){handle =  add_dir((struct dir *) f);}
-    else{handle = add_file(f);}
+    if(is_inode_directory(file_get_inode(f))){
+        handle = add_dir((struct dir *) f);
+        if(handle < 0){dir_close((struct dir *) f);}
+    }
+    else{
+        handle = add_file(f);
+        if(handle < 0){file_close(f);}
+    }
     //handle = add_file(f); /*delete and replace*/
     //lock_release(&locker);
     return handle;
@@ -423,24 +474,18 @@ bytes actually read (0 at end of file), or -1 if the file could
 not be read (due to a condition other than end of file). Fd 0 reads from the 
 keyboard using input_getc(). */
 int read (int fd, void *buffer, unsigned size) {
-    uint8_t * buffer_byte = (uint8_t *) buffer;
-    if(buffer_byte == NULL){return -1;}
-    if(!is_user(buffer_byte)){return -1;}
-    if(fd == STDIN_FILENO){
-	for(unsigned i =0; i < size; i++){
-		buffer_byte[i] = input_getc();
-	}
-	return size;
-    }
-    else{
-	//lock_acquire(&locker);
-	struct fd_elem * f = find_file(fd);
-	if(!f){/*lock_release*/return -1;}
-    	if(f->is_dir){/*lock_release*/return -1;}
-    	int num_bytes_read = file_read(f->file, buffer_byte, size);
-	/*lock_release*/
-	return num_bytes_read;
+    struct fd_elem * f = NULL;
+    if(buffer == NULL){exit(-1);}
+    if(fd != STDIN_FILENO){
+	f = find_file(fd);
+	if(!f){return -1;}
+    	if(f->is_dir){return -1;}
     }
+    uint8_t *page = palloc_get_page(0);
+    if(!page){return -1;}
+    int total = read_to_user(f, buffer, size, -1, page);
+    palloc_free_page(page);
+    return total;
 }
 
 /* Writes size bytes from buffer to the open file fd. 
@@ -462,23 +507,206 @@ Otherwise, lines of text output by different processes may
 end up interleaved on the console, 
 confusing both human readers and our grading scripts. */
 int write (int fd, const void *buffer, unsigned size) {
+    struct fd_elem *f = NULL;
     if(size == 0){return 0;}
-    if(!buffer){return -1;}
-    if(!is_user(buffer)){return -1;}
-    if(fd == STDOUT_FILENO){
-	putbuf(buffer,size);
-        return size;	
+    if(!buffer){exit(-1);}
+    if(fd != STDOUT_FILENO){
+	f = find_file(fd);
+        if(!f){return -1;}
+	if(f->is_dir){return -1;}
     }
-    else{
-         /*lock_acquire(lock_acquire(&locker);locker);*/
-	struct fd_elem *f = find_file(fd);
-        if(!f){/*lock_release*/return -1;}
-	if(f->is_dir){/*lock_release*/return -1;}
-        int num_bytes_written = file_write(f->file,buffer,size);
-	/*lock_release*/
-	return num_bytes_written;
+    uint8_t *page = palloc_get_page(0);
+    if(!page){return -1;}
+    int total = write_from_user(f, buffer, size, -1, page);
+    palloc_free_page(page);
+    return total;
+}
+
+/* Reads size bytes from the file open as fd into buffer, starting
+at byte offset in the file rather than at the file's position,
+which is left alone.  Returns the number of bytes read, or -1 if
+fd is not an open file or offset is negative. */
+int pread (int fd, void *buffer, unsigned size, int offset) {
+    struct fd_elem *f = find_file(fd);
+    if(!f || f->is_dir || offset < 0){return -1;}
+    if(!buffer){exit(-1);}
+    uint8_t *page = palloc_get_page(0);
+    if(!page){return -1;}
+    int total = read_to_user(f, buffer, size, offset, page);
+    palloc_free_page(page);
+    return total;
+}
+
+/* Writes size bytes from buffer to the file open as fd, starting
+at byte offset in the file rather than at the file's position,
+which is left alone.  Returns the number of bytes written, or -1
+if fd is not an open file or offset is negative. */
+int pwrite (int fd, const void *buffer, unsigned size, int offset) {
+    struct fd_elem *f = find_file(fd);
+    if(!f || f->is_dir || offset < 0){return -1;}
+    if(size == 0){return 0;}
+    if(!buffer){exit(-1);}
+    uint8_t *page = palloc_get_page(0);
+    if(!page){return -1;}
+    int total = write_from_user(f, buffer, size, offset, page);
+    palloc_free_page(page);
+    return total;
+}
+
+/* Like read(), but reads into the iovcnt buffers described by iov
+in turn, stopping early at end of file.  Returns the total number
+of bytes read, or -1 if fd is not open or iovcnt is out of range. */
+int readv (int fd, const struct iovec *iov, int iovcnt) {
+    return transfer_iov(fd, iov, iovcnt, false);
+}
+
+/* Like write(), but writes the iovcnt buffers described by iov in
+turn, stopping early if a write comes up short.  Returns the total
+number of bytes written, or -1 if fd is not open or iovcnt is out
+of range. */
+int writev (int fd, const struct iovec *iov, int iovcnt) {
+    return transfer_iov(fd, iov, iovcnt, true);
+}
+
+/* Copies up to length bytes from the file open as in_fd to the
+file open as out_fd, starting at and advancing each file's
+position, without the data passing through user memory.  Returns
+the number of bytes copied, which is less than length at end of
+file, or -1 if either fd is not an open file, the two refer to
+overlapping parts of the same file, or nothing could be copied
+before end of file (for example, because the disk is full). */
+int copy_file_range (int in_fd, int out_fd, unsigned length) {
+    struct fd_elem *in = find_file(in_fd);
+    struct fd_elem *out = find_file(out_fd);
+    if(!in || !out || in->is_dir || out->is_dir){return -1;}
+    if(length > INT_MAX){length = INT_MAX;}
+    if(file_get_inode(in->file) == file_get_inode(out->file)){
+	off_t in_pos = file_tell(in->file);
+	off_t out_pos = file_tell(out->file);
+	if(in_pos - out_pos < (off_t) length && out_pos - in_pos < (off_t) length){
+		return -1;
+	}
     }
+    off_t copied = file_copy(out->file, in->file, length);
+    if(copied == 0 && length > 0
+       && file_tell(in->file) < file_length(in->file)){return -1;}
+    return copied;
 }
+
+/* Reads SIZE bytes from F, or from the keyboard if F is null,
+   into user buffer BUFFER.  Reads at byte offset OFS in the file,
+   or at and advancing the file's position if OFS is negative.
+   Goes a page at a time through kernel page PAGE.  Returns the
+   number of bytes read.  A bad buffer frees PAGE and kills the
+   process. */
+static int
+read_to_user (struct fd_elem *f, uint8_t *buffer, unsigned size, off_t ofs,
+              uint8_t *page)
+{
+    unsigned total = 0;
+    while(total < size){
+	unsigned chunk = size - total < PGSIZE ? size - total : PGSIZE;
+	int n;
+	if(f == NULL){
+		for(n = 0; (unsigned) n < chunk; n++){
+			page[n] = input_getc();
+		}
+	}
+	else if(ofs >= 0){
+		n = file_read_at(f->file, page, chunk, ofs + total);
+	}
+	else{
+		n = file_read(f->file, page, chunk);
+	}
+	if(n > 0 && !copy_to_user(buffer + total, page, n)){
+		palloc_free_page(page);
+		exit(-1);
+	}
+	total += n;
+	if((unsigned) n < chunk){break;}
+    }
+    return total;
+}
+
+/* Writes SIZE bytes from user buffer BUFFER to F, or to the
+   console if F is null.  Writes at byte offset OFS in the file,
+   or at and advancing the file's position if OFS is negative.
+   Goes a page at a time through kernel page PAGE.  Returns the
+   number of bytes written.  A bad buffer frees PAGE and kills
+   the process. */
+static int
+write_from_user (struct fd_elem *f, const uint8_t *buffer, unsigned size,
+                 off_t ofs, uint8_t *page)
+{
+    unsigned total = 0;
+    while(total < size){
+	unsigned chunk = size - total < PGSIZE ? size - total : PGSIZE;
+	int n;
+	if(!copy_from_user(page, buffer + total, chunk)){
+		palloc_free_page(page);
+		exit(-1);
+	}
+	if(f == NULL){
+		putbuf((const char *) page, chunk);
+		n = chunk;
+	}
+	else if(ofs >= 0){
+		n = file_write_at(f->file, page, chunk, ofs + total);
+	}
+	else{
+		n = file_write(f->file, page, chunk);
+	}
+	total += n;
+	if((unsigned) n < chunk){break;}
+    }
+    return total;
+}
+
+/* Does the work of readv() or, if WRITE is true, writev(). */
+static int
+transfer_iov (int fd, const struct iovec *iov, int iovcnt, bool write)
+{
+    struct iovec batch[IOV_BATCH];
+    struct fd_elem *f = NULL;
+    if(iovcnt < 0 || iovcnt > IOV_MAX){return -1;}
+    if(fd != (write ? STDOUT_FILENO : STDIN_FILENO)){
+	f = find_file(fd);
+	if(!f || f->is_dir){return -1;}
+    }
+    uint8_t *page = palloc_get_page(0);
+    if(!page){return -1;}
+
+    /* Copy in a batch of iovecs at a time, then do each one. */
+    int total = 0;
+    int i = 0;
+    while(i < iovcnt){
+	int cnt = iovcnt - i < IOV_BATCH ? iovcnt - i : IOV_BATCH;
+	int j;
+	if(!copy_from_user(batch, iov + i, cnt * sizeof *batch)){
+		palloc_free_page(page);
+		exit(-1);
+	}
+	for(j = 0; j < cnt; j++){
+		size_t len = batch[j].iov_len;
+		int n;
+		if(len > INT_MAX - (size_t) total
+		   || (len > 0 && !is_user_range(batch[j].iov_base, len))){
+			palloc_free_page(page);
+			exit(-1);
+		}
+		n = (write
+		     ? write_from_user(f, batch[j].iov_base, len, -1, page)
+		     : read_to_user(f, batch[j].iov_base, len, -1, page));
+		total += n;
+		if((size_t) n < len){goto done;}
+	}
+	i += cnt;
+    }
+ done:
+    palloc_free_page(page);
+    return total;
+}
+
 /* Changes the next byte to be read or written in open file fd to position, 
 expressed in bytes from the beginning of the file. 
 (Thus, a position of 0 is the file's start.)
@@ -517,75 +745,65 @@ unsigned tell (int fd) {
 closes all its open file descriptors, as if by calling this function for each one. */
 void close (int fd) { 
     struct fd_elem  *file_to_close = find_file(fd);
-    if(!file_to_close){return -1;}
-    if(!file_to_close->file){return -1;}
+    if(!file_to_close){return;}
     /*lock_acquire(lock_acquire(&locker);locker);*/
-    if(file_to_close->is_dir){dir_close(file_to_close->file);}
+    if(file_to_close->is_dir){dir_close(file_to_close->dir);}
     else{file_close(file_to_close->file);}
-    list_remove(&file_to_close->elem);
-    free(file_to_close);
+    struct thread *t = thread_current();
+    t->fds[fd] = NULL;
+    if(fd < t->fd_free){t->fd_free = fd;}
+    kmem_cache_free(fd_elem_cache, file_to_close);
     /*lock_release*/
     return;
 }
 
 /* Find file element given handle number */
 struct fd_elem * find_file (int number){
-    /* still to do:  get current file_list*/
     struct thread *current_thread = thread_current();
-    struct list_elem *i;
-    for(i = list_begin(&current_thread->file_lists);i != list_end(&current_thread->file_lists);i = list_next(i)){
-        struct fd_elem *fl = list_entry(i, struct fd_elem, elem);
-        if(fl->handle == number){
-            return fl;
-        }
+    if(number < 0 || number >= current_thread->fd_cnt){return NULL;}
+    return current_thread->fds[number]; /* NULL if not open */
+}
+
+/* Puts FD into T's table of open files under HANDLE, or under
+   the lowest free handle if HANDLE is -1, growing the table as
+   needed.  Returns the handle, or -1 if memory runs out. */
+int install_fd(struct thread *t, struct fd_elem *fd, int handle){
+    bool lowest = handle < 0;
+    if(lowest){
+        handle = t->fd_free;
+        while(handle < t->fd_cnt && t->fds[handle] != NULL){handle++;}
+    }
+    if(handle >= t->fd_cnt){
+        int cnt = t->fd_cnt ? t->fd_cnt : 16;
+        while(cnt <= handle){cnt *= 2;}
+        struct fd_elem **fds = realloc(t->fds, cnt * sizeof *fds);
+        if(!fds){return -1;}
+        memset(fds + t->fd_cnt, 0, (cnt - t->fd_cnt) * sizeof *fds);
+        t->fds = fds;
+        t->fd_cnt = cnt;
     }
-    return(NULL); /*file not found*/
+    ASSERT(t->fds[handle] == NULL);
+    t->fds[handle] = fd;
+    fd->handle = handle;
+    if(lowest || handle == t->fd_free){t->fd_free = handle + 1;}
+    return handle;
 }
 
+/* Copies the user string STRING into a new page, truncating it
+   to PGSIZE - 1 bytes, and returns the page, which the caller
+   must free.  Returns a null pointer if STRING is bad or memory
+   runs out. */
 char * string_to_page(const char *string){
     char *page;
    
     page = palloc_get_page(0);
-    if (page == NULL){exit(-1);}
-    if(string == NULL){exit(-1);}
-   
-    for(int i = 0; i < PGSIZE; i++){
-        if(string >= (char *) PHYS_BASE){
-            palloc_free_page(page);
-            thread_exit();
-        }
-        if(page[i] == '\0') {return page;}
+    if (page == NULL){return NULL;}
+    if(strncpy_from_user(page, string, PGSIZE) < 0){
+        palloc_free_page(page);
+        return NULL;
     }
-    page[PGSIZE -1] = '\0';
     return page;
 }
-
-/* Reads a byte at user virtual address UADDR must be below PHYS_BASE. 
-Returns the byte value if successful, -1 if a segfault occured. */
-static int get_user(const uint8_t *uaddr){
-    int result;
-    asm ("mov1 $1f, %0; movzb1, %0; 1:" : "=&a" (result) : "m" (*uaddr));
-    return result;
-}
-
-/* Writes BYTE to user address UDST.
-   UDST must be below PHY_BASE.
-   Returns true if successful, false if a seqfault occurred. */
-static bool put_user(uint8_t *udst, uint8_t byte) {
-    int error_code;
-    asm ("mov1 $1f, %0; movb %b2, %1: 1:" : "=&a" (error_code), "=m" (*udst) : "q" (byte));
-    return error_code != -1;
-}
-
-// 1. User programs cannot access kernel VM
-// 2. Kernal threads can access User VM ONLY if User VM is mapped already
-void valid_kernel(const void *check_valid) {
-    if (!is_user(check_valid)) {exit(-1);}
-   
-    // Check if process has allocated page
-    void *page = pagedir_get_page(thread_current()->pagedir,check_valid);
-    if(!page) {exit(-1);}
-}
                         
                         
 /* ------------------------- */
@@ -632,14 +850,81 @@ you should increase this value from the default of 14.
 
 */
 bool readdir (int fd, char *name) {
+	char kname[NAME_MAX + 1];
 	struct fd_elem *f = find_file(fd);
 	if(!f){return false;}
 	else if(!f->is_dir){return false;}
 	if(!name){return false;}
-	bool success = dir_readdir(f->dir, name);
+	bool success = dir_readdir(f->dir, kname);
+	if(success && !copy_to_user(name, kname, strlen(kname) + 1)){exit(-1);}
 	return success;
 }
 
+/*
+Fills buffer, which is size bytes long, with as many of the next entries
+in directory fd as fit, as an array of struct dir_record.  Returns the
+number of entries stored, 0 if there are no more, or -1 if fd is not
+an open directory or buffer is too small to hold even one entry.
+*/
+int getdents (int fd, struct dir_record *buffer, unsigned size) {
+	struct fd_elem *f = find_file(fd);
+	if(!f || !f->is_dir || size < sizeof *buffer){return -1;}
+	if(!buffer){exit(-1);}
+
+	/* Read a page's worth of entries at a time, then copy them out. */
+	struct dir_record *page = palloc_get_page(0);
+	if(!page){return -1;}
+	size_t cnt = size / sizeof *buffer;
+	size_t total = 0;
+	while(total < cnt){
+		size_t chunk = cnt - total < PGSIZE / sizeof *page ? cnt - total : PGSIZE / sizeof *page;
+		size_t n = dir_readdir_many(f->dir, page, chunk);
+		if(n > 0 && !copy_to_user(buffer + total, page, n * sizeof *page)){
+			palloc_free_page(page);
+			exit(-1);
+		}
+		total += n;
+		if(n < chunk){break;}
+	}
+	palloc_free_page(page);
+	return total;
+}
+
+/* Stores INODE's status into ST, counting EXTRA fewer openers
+   than it has. */
+static void
+fill_stat (struct inode *inode, int extra, struct stat *st)
+{
+	st->size = inode_length(inode);
+	st->inumber = inode_get_inumber(inode);
+	st->is_dir = is_inode_directory(inode);
+	st->open_cnt = get_open_count(inode) - extra;
+}
+
+/*
+Stores the size, inode number and type of file, and the number of
+times it is open, into st.  Looks file up without opening it.
+Returns true if successful, false if there is no such file.
+*/
+bool stat (const char *file, struct stat *st) {
+	struct inode *inode = filesys_lookup(file);
+	if(!inode){return false;}
+	fill_stat(inode, 1, st);
+	inode_close(inode);
+	return true;
+}
+
+/*
+Like stat(), but for the file or directory open as fd.
+*/
+bool fstat (int fd, struct stat *st) {
+	struct fd_elem *f = find_file(fd);
+	if(!f){return false;}
+	fill_stat(f->is_dir ? dir_get_inode(f->dir) : file_get_inode(f->file),
+	          0, st);
+	return true;
+}
+
 /*
 Returns true if fd represents a directory, false if it represents an ordinary file.
 */
@@ -670,26 +955,28 @@ int inumber (int fd) {
 }          
 
 int add_dir(struct dir *d){
-	struct fd_elem *fd = malloc(sizeof(struct fd_elem));
+	struct fd_elem *fd = kmem_cache_alloc(fd_elem_cache);
 	if(!fd){return -1;}
-	struct thread * t = thread_current();
 	fd->is_dir = true;
 	fd->dir = d;
-	fd->handle = t->handle;
-	t->handle++;
-	list_push_back(&t->file_lists, &fd->elem);
+	fd->file = NULL;
+	if(install_fd(thread_current(), fd, -1) < 0){
+		kmem_cache_free(fd_elem_cache, fd);
+		return -1;
+	}
 	return fd->handle;
 }
 
 int add_file(struct file *f){
-	struct fd_elem *fd = malloc(sizeof(struct fd_elem));
-	struct thread * t = thread_current();
+	struct fd_elem *fd = kmem_cache_alloc(fd_elem_cache);
 	if(!fd){return -1;}
 	fd->is_dir = false;
 	fd->file = f;
-	fd->handle = t->handle;
-	t->handle++;
-	list_push_back(&t->file_lists, &fd->elem);
+	fd->dir = NULL;
+	if(install_fd(thread_current(), fd, -1) < 0){
+		kmem_cache_free(fd_elem_cache, fd);
+		return -1;
+	}
 	return fd->handle;
 }
 
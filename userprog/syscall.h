@@ -7,8 +7,11 @@
 #include "filesys/directory.h"
 #include "filesys/file.h"
 
+struct thread;
+
+/* An open file or directory.  A process's handles index its
+   thread's fds table directly. */
 struct fd_elem{
-    struct list_elem elem;
     struct file *file;
     int handle;
     struct dir *dir;
@@ -17,6 +20,9 @@ struct fd_elem{
 
 
 struct lock locker;
+extern struct kmem_cache *fd_elem_cache;
 void syscall_init (void);
+void syscall_print_stats (void);
 void exit (int);
+int install_fd (struct thread *, struct fd_elem *, int handle);
 #endif /* userprog/syscall.h */
@@ -0,0 +1,143 @@
+#include "userprog/uaccess.h"
+#include "threads/vaddr.h"
+
+/* Access to user memory from the kernel.
+
+   These functions read and write user memory directly, without
+   first checking that it is mapped.  If an access faults,
+   page_fault() looks up the faulting instruction in the
+   exception table and, if it is there, resumes execution at the
+   matching fixup address instead of killing the kernel.  A
+   buffer of any size, spanning any number of pages, is thus
+   validated as a side effect of copying it, at no extra cost
+   when all is well.
+
+   The caller must still make sure that the buffer lies entirely
+   below PHYS_BASE, because kernel memory is always mapped and so
+   would never fault. */
+
+/* Exception table entry: if the instruction at INSN faults,
+   continue at FIXUP. */
+struct exception_entry 
+  {
+    uintptr_t insn;
+    uintptr_t fixup;
+  };
+
+/* Exception table, gathered from the __ex_table sections by the
+   linker script. */
+extern const struct exception_entry _start_ex_table[], _end_ex_table[];
+
+/* Returns true if the SIZE bytes starting at UADDR all lie in
+   user virtual memory.  Says nothing about whether they are
+   mapped. */
+bool
+is_user_range (const void *uaddr, size_t size) 
+{
+  uintptr_t start = (uintptr_t) uaddr;
+  return start + size >= start && start + size <= (uintptr_t) PHYS_BASE;
+}
+
+/* Copies SIZE bytes from user address USRC to kernel address
+   DST.  Returns true if successful, false if any byte of USRC is
+   not mapped or not in user memory. */
+bool
+copy_from_user (void *dst, const void *usrc, size_t size) 
+{
+  if (!is_user_range (usrc, size))
+    return false;
+
+  /* On a fault, rep movsb stops with ECX holding the number of
+     bytes left. */
+  asm volatile ("1: rep movsb\n"
+                "2:\n"
+                ".section __ex_table, \"a\"\n"
+                "   .long 1b, 2b\n"
+                ".previous"
+                : "+D" (dst), "+S" (usrc), "+c" (size) : : "memory");
+  return size == 0;
+}
+
+/* Copies SIZE bytes from kernel address SRC to user address
+   UDST.  Returns true if successful, false if any byte of UDST
+   is not mapped, not writable, or not in user memory.  Writes to
+   copy-on-write pages are resolved by page_fault() as usual. */
+bool
+copy_to_user (void *udst, const void *src, size_t size) 
+{
+  if (!is_user_range (udst, size))
+    return false;
+
+  asm volatile ("1: rep movsb\n"
+                "2:\n"
+                ".section __ex_table, \"a\"\n"
+                "   .long 1b, 2b\n"
+                ".previous"
+                : "+D" (udst), "+S" (src), "+c" (size) : : "memory");
+  return size == 0;
+}
+
+/* Reads the byte at user address UADDR, which must be below
+   PHYS_BASE.  Returns the byte value if successful, -1 if the
+   access faulted. */
+static inline int
+get_user (const uint8_t *uaddr) 
+{
+  int result;
+  asm ("1: movzbl %1, %0\n"
+       "2:\n"
+       ".section .fixup, \"ax\"\n"
+       "3: movl $-1, %0\n"
+       "   jmp 2b\n"
+       ".previous\n"
+       ".section __ex_table, \"a\"\n"
+       "   .long 1b, 3b\n"
+       ".previous"
+       : "=r" (result) : "m" (*uaddr));
+  return result;
+}
+
+/* Copies the null-terminated string at user address USRC into
+   the SIZE-byte kernel buffer DST.  Returns the length of the
+   string, not counting the null terminator.  If the string does
+   not fit, copies SIZE - 1 bytes, null-terminates DST, and
+   returns SIZE - 1.  Returns -1 if USRC is bad. */
+int
+strncpy_from_user (char *dst, const char *usrc, size_t size) 
+{
+  const uint8_t *src = (const uint8_t *) usrc;
+  size_t i;
+
+  if (size == 0)
+    return 0;
+  for (i = 0; i < size - 1; i++) 
+    {
+      int c;
+
+      if (!is_user_vaddr (src + i))
+        return -1;
+      c = get_user (src + i);
+      if (c < 0)
+        return -1;
+      dst[i] = c;
+      if (c == '\0')
+        return i;
+    }
+  dst[i] = '\0';
+  return i;
+}
+
+/* If EIP is the address of a kernel instruction that accesses
+   user memory through one of the functions above, returns the
+   address at which to continue after a fault.  Otherwise,
+   returns 0. */
+uintptr_t
+uaccess_fixup (uintptr_t eip) 
+{
+  const struct exception_entry *e;
+
+  for (e = _start_ex_table; e < _end_ex_table; e++)
+    if (e->insn == eip)
+      return e->fixup;
+  return 0;
+}
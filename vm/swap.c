@@ -0,0 +1,96 @@
+#include "vm/swap.h"
+#include <bitmap.h>
+#include <debug.h>
+#include "devices/block.h"
+#include "threads/synch.h"
+#include "threads/vaddr.h"
+#include "vm/zcache.h"
+
+/* Swap space.  The swap device is divided into page-size
+   "slots".  A page that is swapped out is first offered to the
+   compressed cache in zcache.c, which keeps it in RAM if it
+   compresses well and writes it back to its slot on the device
+   only when the cache fills up.  Either way the page keeps the
+   same slot number, so callers never need to know where it
+   actually is. */
+
+/* Number of sectors per page. */
+#define PAGE_SECTORS (PGSIZE / BLOCK_SECTOR_SIZE)
+
+static struct block *swap_device;       /* Swap device, or null. */
+static struct bitmap *used_slots;       /* Slots in use. */
+static struct lock swap_lock;           /* Protects used_slots. */
+
+/* Initializes swap space on the BLOCK_SWAP device, if there is
+   one, and the compressed cache in front of it. */
+void
+swap_init (void) 
+{
+  size_t slot_cnt = 0;
+
+  swap_device = block_get_role (BLOCK_SWAP);
+  if (swap_device != NULL)
+    slot_cnt = block_size (swap_device) / PAGE_SECTORS;
+  used_slots = bitmap_create (slot_cnt);
+  if (used_slots == NULL)
+    PANIC ("bitmap creation failed--swap device is too large");
+  lock_init (&swap_lock);
+  zcache_init ();
+}
+
+/* Swaps out the page at KPAGE and returns the slot that now
+   holds its contents, or SWAP_ERROR if swap space is full. */
+size_t
+swap_out (const void *kpage) 
+{
+  size_t slot;
+
+  lock_acquire (&swap_lock);
+  slot = bitmap_scan_and_flip (used_slots, 0, 1, false);
+  lock_release (&swap_lock);
+  if (slot == BITMAP_ERROR)
+    return SWAP_ERROR;
+
+  if (!zcache_store (slot, kpage))
+    swap_write_slot (slot, kpage);
+  return slot;
+}
+
+/* Reads the contents of SLOT into KPAGE and frees SLOT. */
+void
+swap_in (size_t slot, void *kpage) 
+{
+  size_t i;
+
+  ASSERT (bitmap_test (used_slots, slot));
+
+  if (!zcache_load (slot, kpage))
+    for (i = 0; i < PAGE_SECTORS; i++)
+      block_read (swap_device, slot * PAGE_SECTORS + i,
+                  (uint8_t *) kpage + i * BLOCK_SECTOR_SIZE);
+  swap_free (slot);
+}
+
+/* Frees SLOT without reading it, as when a process that has
+   pages in swap exits. */
+void
+swap_free (size_t slot) 
+{
+  zcache_discard (slot);
+  lock_acquire (&swap_lock);
+  bitmap_reset (used_slots, slot);
+  lock_release (&swap_lock);
+}
+
+/* Writes the page at KPAGE to SLOT on the swap device.  Used by
+   the compressed cache to write back entries it evicts. */
+void
+swap_write_slot (size_t slot, const void *kpage) 
+{
+  size_t i;
+
+  ASSERT (swap_device != NULL);
+  for (i = 0; i < PAGE_SECTORS; i++)
+    block_write (swap_device, slot * PAGE_SECTORS + i,
+                 (const uint8_t *) kpage + i * BLOCK_SECTOR_SIZE);
+}
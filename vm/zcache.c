@@ -0,0 +1,250 @@
+#include "vm/zcache.h"
+#include <debug.h>
+#include <hash.h>
+#include <list.h>
+#include <lz.h>
+#include <round.h>
+#include <stdint.h>
+#include <string.h>
+#include "threads/init.h"
+#include "threads/malloc.h"
+#include "threads/shrinker.h"
+#include "threads/synch.h"
+#include "threads/vaddr.h"
+#include "vm/swap.h"
+
+/* Compressed swap cache.
+
+   Pages on their way out to swap are compressed with lz.c and
+   kept in kernel memory, indexed by swap slot.  Reading one back
+   costs a decompression instead of a disk access.  The cache is
+   limited to a fraction of RAM; when it is full, the least
+   recently stored entries are decompressed and written to their
+   slots on the swap device.  Pages that do not compress to at
+   most MAX_ENTRY_SIZE bytes are not worth keeping and go
+   straight to disk.  Under memory pressure, a shrinker writes
+   back entries early.
+
+   Writing back an entry does not hold zcache_lock, so loads and
+   discards need not wait for the disk.  The entry stays in
+   zcache_map, marked as being written, until the write is done:
+   a load can still decompress it in the meantime, and a discard,
+   which lets the slot be reused, waits for the write to finish. */
+
+/* Largest compressed page worth caching. */
+#define MAX_ENTRY_SIZE (PGSIZE * 3 / 4)
+
+/* A compressed page. */
+struct zentry 
+  {
+    struct hash_elem hash_elem;         /* Element in zcache_map. */
+    struct list_elem lru_elem;          /* Element in lru_list. */
+    size_t slot;                        /* Swap slot. */
+    size_t size;                        /* Size of DATA in bytes. */
+    bool writing;                       /* Being written back? */
+    uint8_t data[];                     /* Compressed contents. */
+  };
+
+static struct hash zcache_map;          /* Entries by slot. */
+static struct list lru_list;            /* Entries, newest first. */
+static struct lock zcache_lock;         /* Protects all of the above. */
+static struct condition written;        /* Signaled when a write ends. */
+static size_t used_bytes;               /* Bytes of compressed data. */
+static size_t max_bytes;                /* Budget for used_bytes. */
+
+/* Scratch space for storing entries, protected by zcache_lock. */
+static uint8_t lz_work[LZ_WORK_SIZE];
+static uint8_t bounce[PGSIZE];
+
+/* Scratch space for writing back entries. */
+static struct lock writeback_lock;      /* Protects writeback_page. */
+static uint8_t writeback_page[PGSIZE];
+
+static hash_hash_func zentry_hash;
+static hash_less_func zentry_less;
+static struct zentry *lookup (size_t slot);
+static size_t write_back_oldest (void);
+static void remove_entry (struct zentry *);
+static shrink_func zcache_shrink;
+
+/* Shrinker for the cache. */
+static struct shrinker zcache_shrinker = { "zcache", zcache_shrink,
+                                           { NULL, NULL } };
+
+/* Initializes the compressed swap cache, giving it a budget of
+   1/16 of RAM. */
+void
+zcache_init (void) 
+{
+  hash_init (&zcache_map, zentry_hash, zentry_less, NULL);
+  list_init (&lru_list);
+  lock_init (&zcache_lock);
+  cond_init (&written);
+  lock_init (&writeback_lock);
+  max_bytes = init_ram_pages * PGSIZE / 16;
+  shrinker_register (&zcache_shrinker);
+}
+
+/* Tries to store a compressed copy of KPAGE under SLOT.
+   Returns true if successful.  Returns false if the page does
+   not compress well or memory is short, in which case the
+   caller must write KPAGE to SLOT itself. */
+bool
+zcache_store (size_t slot, const void *kpage) 
+{
+  struct zentry *e;
+  size_t size;
+
+  lock_acquire (&zcache_lock);
+  ASSERT (lookup (slot) == NULL);
+
+  size = lz_compress (kpage, PGSIZE, bounce, MAX_ENTRY_SIZE, lz_work);
+  e = size != 0 ? malloc (sizeof *e + size) : NULL;
+  if (e == NULL) 
+    {
+      lock_release (&zcache_lock);
+      return false;
+    }
+  e->slot = slot;
+  e->size = size;
+  e->writing = false;
+  memcpy (e->data, bounce, size);
+  hash_insert (&zcache_map, &e->hash_elem);
+  list_push_front (&lru_list, &e->lru_elem);
+  used_bytes += size;
+
+  /* Write back the oldest entries until we are within budget. */
+  while (used_bytes > max_bytes && !list_empty (&lru_list)) 
+    write_back_oldest ();
+  lock_release (&zcache_lock);
+  return true;
+}
+
+/* If SLOT is in the cache, decompresses it into KPAGE, drops it
+   from the cache (or leaves that to the write back, if one is
+   under way), and returns true.  Otherwise returns false and the
+   page must be read from the swap device. */
+bool
+zcache_load (size_t slot, void *kpage) 
+{
+  struct zentry *e;
+
+  lock_acquire (&zcache_lock);
+  e = lookup (slot);
+  if (e != NULL) 
+    {
+      if (lz_decompress (e->data, e->size, kpage, PGSIZE) != PGSIZE)
+        PANIC ("zcache: corrupt entry for swap slot %zu", slot);
+      if (!e->writing)
+        remove_entry (e);
+    }
+  lock_release (&zcache_lock);
+  return e != NULL;
+}
+
+/* Drops SLOT from the cache, if it is there.  If SLOT is being
+   written back, waits for that to finish, so that the caller may
+   reuse SLOT. */
+void
+zcache_discard (size_t slot) 
+{
+  struct zentry *e;
+
+  lock_acquire (&zcache_lock);
+  while ((e = lookup (slot)) != NULL && e->writing)
+    cond_wait (&written, &zcache_lock);
+  if (e != NULL)
+    remove_entry (e);
+  lock_release (&zcache_lock);
+}
+
+/* Returns the entry for SLOT, or a null pointer if there is
+   none.  The caller must hold zcache_lock. */
+static struct zentry *
+lookup (size_t slot) 
+{
+  struct zentry key;
+  struct hash_elem *e;
+
+  key.slot = slot;
+  e = hash_find (&zcache_map, &key.hash_elem);
+  return e != NULL ? hash_entry (e, struct zentry, hash_elem) : NULL;
+}
+
+/* Writes the least recently stored entry to its swap slot and
+   drops it from the cache, and returns the number of bytes of
+   compressed data released.  The caller must hold zcache_lock,
+   which is released during the write and then reacquired. */
+static size_t
+write_back_oldest (void) 
+{
+  struct zentry *old = list_entry (list_pop_back (&lru_list),
+                                   struct zentry, lru_elem);
+  size_t size = old->size;
+
+  /* Take OLD off the LRU list and out of the budget.  It stays
+     in zcache_map, and its data does not change, until the write
+     is done. */
+  old->writing = true;
+  used_bytes -= size;
+  lock_release (&zcache_lock);
+
+  lock_acquire (&writeback_lock);
+  if (lz_decompress (old->data, size, writeback_page, PGSIZE) != PGSIZE)
+    PANIC ("zcache: corrupt entry for swap slot %zu", old->slot);
+  swap_write_slot (old->slot, writeback_page);
+  lock_release (&writeback_lock);
+
+  lock_acquire (&zcache_lock);
+  hash_delete (&zcache_map, &old->hash_elem);
+  free (old);
+  cond_broadcast (&written, &zcache_lock);
+  return size;
+}
+
+/* Shrinker for the cache.  Writes back the oldest entries until
+   about PAGE_CNT pages of memory have been released. */
+static size_t
+zcache_shrink (size_t page_cnt) 
+{
+  size_t target = page_cnt * PGSIZE;
+  size_t released = 0;
+
+  if (lock_held_by_current_thread (&zcache_lock)
+      || lock_held_by_current_thread (&writeback_lock)
+      || !lock_try_acquire (&zcache_lock))
+    return 0;
+
+  while (!list_empty (&lru_list) && released < target)
+    released += write_back_oldest ();
+  lock_release (&zcache_lock);
+  return DIV_ROUND_UP (released, PGSIZE);
+}
+
+/* Removes E from the cache and frees it.  The caller must hold
+   zcache_lock. */
+static void
+remove_entry (struct zentry *e) 
+{
+  hash_delete (&zcache_map, &e->hash_elem);
+  list_remove (&e->lru_elem);
+  used_bytes -= e->size;
+  free (e);
+}
+
+/* Returns a hash value for the entry in E. */
+static unsigned
+zentry_hash (const struct hash_elem *e, void *aux UNUSED) 
+{
+  const struct zentry *z = hash_entry (e, struct zentry, hash_elem);
+  return hash_int (z->slot);
+}
+
+/* Returns true if entry A has a lower slot than entry B. */
+static bool
+zentry_less (const struct hash_elem *a, const struct hash_elem *b,
+             void *aux UNUSED) 
+{
+  return (hash_entry (a, struct zentry, hash_elem)->slot
+          < hash_entry (b, struct zentry, hash_elem)->slot);
+}
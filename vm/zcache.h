@@ -0,0 +1,12 @@
+#ifndef VM_ZCACHE_H
+#define VM_ZCACHE_H
+
+#include <stdbool.h>
+#include <stddef.h>
+
+void zcache_init (void);
+bool zcache_store (size_t slot, const void *kpage);
+bool zcache_load (size_t slot, void *kpage);
+void zcache_discard (size_t slot);
+
+#endif /* vm/zcache.h */